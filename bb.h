@@ -5,15 +5,231 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+
+// fd and mmap based parts need POSIX.1-2008, which strict ISO modes hide unless _POSIX_C_SOURCE is defined
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+#if defined(__APPLE__) || (defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200809L)
+#include <sys/uio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <limits.h>
+#define BB_POSIX
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+#endif
+
+// memfd/mremap based parts need glibc extensions, define _GNU_SOURCE before any include to get them
+#if defined(__linux__) && defined(_GNU_SOURCE)
+#include <sys/syscall.h>
+#include <sys/sendfile.h>
+#define BB_LINUX
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define BB_IO_URING
+#endif
+#endif
+#endif
+
+// SSE2 is baseline on x86-64, AVX2 is picked at runtime
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define BB_X86
+#endif
+
+// contents up to this size live next to the BinBuffer struct, in the same allocation (see BinBufferInline)
+#ifndef BB_INLINE_CAPACITY
+#define BB_INLINE_CAPACITY 64
+#endif
+
+// buffer pool: size classes are powers of two from BB_POOL_MIN_SIZE, each thread caches a few per class
+#ifndef BB_POOL_CLASSES
+#define BB_POOL_CLASSES 16
+#endif
+#ifndef BB_POOL_MIN_SIZE
+#define BB_POOL_MIN_SIZE 128
+#endif
+#ifndef BB_POOL_THREAD_CACHE
+#define BB_POOL_THREAD_CACHE 32
+#endif
+#ifndef BB_POOL_SHARED_MAX
+#define BB_POOL_SHARED_MAX 1024
+#endif
+
+// worker threads of the async I/O fallback used where io_uring isn't available
+#ifndef BB_IO_THREADS
+#define BB_IO_THREADS 4
+#endif
+
+// bb_read_fd makes room for at least this many bytes (or the requested length, if smaller) before reading
+#ifndef BB_READ_CHUNK
+#define BB_READ_CHUNK 65536
+#endif
+
+// growth factor applied to capacity when appending past the end, as a fraction
+#ifndef BB_GROWTH_NUM
+#define BB_GROWTH_NUM 2
+#endif
+#ifndef BB_GROWTH_DEN
+#define BB_GROWTH_DEN 1
+#endif
+
+typedef enum {
+    BB_STORAGE_HEAP,
+    BB_STORAGE_INLINE,          // data points at the inline_data of a BinBufferInline, spills to the heap when grown
+    BB_STORAGE_MAP_READONLY,    // read-only file mapping, can't be written nor grown
+    BB_STORAGE_MAP_PRIVATE,     // copy-on-write file mapping, moves to the heap when grown
+    BB_STORAGE_MAP_SHARED,      // writable file mapping, grows the file; truncated to length on destroy
+    BB_STORAGE_MAP_ANON,        // anonymous mapping, grows with mremap instead of copying
+    BB_STORAGE_MAP_HUGE,        // same, with transparent huge pages requested
+} BinBufferStorage;
+
+typedef enum {
+    BB_ADVISE_NORMAL,
+    BB_ADVISE_SEQUENTIAL,
+    BB_ADVISE_RANDOM,
+} BinBufferAdvice;
 
 typedef struct _binbuf_s {
     char* data;
     size_t length;
     size_t capacity;
+    BinBufferStorage storage;
+    int fd;                 // backing file of BB_STORAGE_MAP_SHARED, -1 otherwise
+    uint32_t crc32c;        // CRC-32C of data[0..crc32c_length), see bb_crc32c_running
+    size_t crc32c_length;
+    bool crc32c_tracking;   // bb_append folds new bytes into crc32c while they're still in cache
+#ifdef DEBUG
+    uint64_t generation;    // bumped every time data may have moved
+#endif
 } BinBuffer;
 
+// a BinBuffer followed by its first BB_INLINE_CAPACITY bytes of storage, so only small buffers pay for them.
+// While the contents are inline, bb.data points into this struct: it must not be copied or moved by value
+// until a grow has spilled them to the heap
+typedef struct {
+    BinBuffer bb;
+    char inline_data[BB_INLINE_CAPACITY];
+} BinBufferInline;
+
+// non-owning slice of BinBuffer contents, invalidated by anything that may move data
+typedef struct {
+    const char* data;
+    size_t length;
+#ifdef DEBUG
+    const BinBuffer* _bb;
+    uint64_t _generation;
+#endif
+} BinBufferView;
+
+// read cursor over BinBuffer contents; any failed read sets error and yields 0 from then on
+typedef struct {
+    const char* data;
+    size_t length;
+    size_t pos;
+    bool error;
+} BinReader;
+
+// list of fixed-size chunks - growing never moves already written bytes
+typedef struct {
+    char** chunks;
+    size_t chunk_count;
+    size_t chunk_slots;
+    size_t chunk_size;
+    size_t length;
+} ChunkedBinBuffer;
+
+// contents with a movable hole at the edit point - nearby inserts and erases only shift the bytes in between
+typedef struct {
+    char* data;
+    size_t capacity;
+    size_t gap_start;
+    size_t gap_end;
+} GapBinBuffer;
+
+#ifdef BB_LINUX
+// byte ring mapped twice back-to-back, so both free and used space are always one contiguous span
+typedef struct {
+    char* data;
+    size_t capacity;
+    size_t head;
+    size_t length;
+} BinRing;
+
+typedef struct {
+    uint64_t user_data;
+    int64_t result;     // bytes transferred, or -errno
+} BinBufferIOCompletion;
+
+typedef struct {
+    BinBuffer* bb;          // buffer in use until completion; a read target's length grows then
+    struct iovec* iov;      // next part still to transfer
+    struct iovec* iov_owned;
+    struct iovec single;
+    size_t iov_count;
+    size_t remaining;
+    size_t done;
+    bool read;
+    int fd;
+    uint64_t offset;
+    uint64_t user_data;
+    int64_t result;
+} _BBIORequest;
+
+// batches of reads and writes in flight at once - through io_uring when the kernel allows, worker threads otherwise
+typedef struct {
+    unsigned depth;
+    _BBIORequest* requests;
+    unsigned* free_slots;
+    unsigned free_count;
+    bool uring;
+
+    int ring_fd;
+    void* sq_ring;
+    void* cq_ring;
+    void* sqes;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    void* cqes;
+    unsigned to_submit;
+
+    pthread_t workers[BB_IO_THREADS];
+    unsigned worker_count;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready, work_done;
+    unsigned *staged, *queue, *completed;
+    unsigned staged_count, queue_head, queue_count, completed_head, completed_count;
+    bool stopping;
+} BinBufferIO;
+#endif
+
 BinBuffer* bb_create(size_t capacity);
+BinBuffer* bb_adopt(char* data, size_t length, size_t capacity);    // takes ownership of heap-allocated data
 bool bb_destroy(BinBuffer* bb);
+// for BinBuffers living on the stack or inside other structs: bb_init starts empty and allocates on first
+// append, bb_init_inline starts on the inline bytes and returns the BinBuffer to use
+void bb_init(BinBuffer* bb);
+BinBuffer* bb_init_inline(BinBufferInline* ibb);
+void bb_deinit(BinBuffer* bb);  // frees contents, not the struct
+#ifdef BB_POSIX
+// storage must be BB_STORAGE_MAP_READONLY, _PRIVATE or _SHARED (NULL otherwise); contents start as the whole file
+BinBuffer* bb_map_file(const char* path, BinBufferStorage storage, BinBufferAdvice advice);
+#endif
+#ifdef BB_LINUX
+// for buffers of many megabytes - growth moves page tables instead of copying bytes
+BinBuffer* bb_create_large(size_t capacity, bool huge_pages);
+#endif
 
 bool bb_append(BinBuffer* bb, const char* data, size_t length);
 bool bb_append_byte(BinBuffer* bb, char byte);
@@ -24,43 +240,266 @@ bool bb_set_byte(BinBuffer* bb, size_t index, char byte);
 char* bb_get(BinBuffer* bb, size_t index, size_t length);
 char bb_get_byte(BinBuffer* bb, size_t index);
 char* bb_collect(BinBuffer* bb);    // also frees the BinBuffer
+char* bb_take(BinBuffer* bb, bool shrink);  // like bb_collect, but hands over data without copying
+
+BinBufferView bb_view(BinBuffer* bb, size_t index, size_t length);
+bool bb_view_valid(BinBufferView view);
 
 bool bb_expand(BinBuffer* bb, size_t new_capacity);
+bool bb_reserve(BinBuffer* bb, size_t additional);  // makes room for at least `additional` more bytes
+char* bb_claim(BinBuffer* bb, size_t length);   // appends `length` uninitialized bytes, returns pointer to them
+bool bb_truncate(BinBuffer* bb, size_t length); // shrinks contents to `length`, keeping capacity; false if longer
+void bb_clear(BinBuffer* bb);                   // bb_truncate to 0
+
+// raw encoders - write into already claimed memory, return pointer past the written bytes
+char* bb_store_u16_le(char* dst, uint16_t value);
+char* bb_store_u32_le(char* dst, uint32_t value);
+char* bb_store_u64_le(char* dst, uint64_t value);
+char* bb_store_f64_le(char* dst, double value);
+char* bb_store_u16_be(char* dst, uint16_t value);
+char* bb_store_u32_be(char* dst, uint32_t value);
+char* bb_store_u64_be(char* dst, uint64_t value);
+char* bb_store_f64_be(char* dst, double value);
+char* bb_store_uvarint(char* dst, uint64_t value);  // LEB128, at most BB_VARINT_MAX bytes
+char* bb_store_svarint(char* dst, int64_t value);   // zigzag + LEB128
+#define BB_VARINT_MAX 10
+
+bool bb_put_u16_le(BinBuffer* bb, uint16_t value);
+bool bb_put_u32_le(BinBuffer* bb, uint32_t value);
+bool bb_put_u64_le(BinBuffer* bb, uint64_t value);
+bool bb_put_f64_le(BinBuffer* bb, double value);
+bool bb_put_u16_be(BinBuffer* bb, uint16_t value);
+bool bb_put_u32_be(BinBuffer* bb, uint32_t value);
+bool bb_put_u64_be(BinBuffer* bb, uint64_t value);
+bool bb_put_f64_be(BinBuffer* bb, double value);
+bool bb_put_uvarint(BinBuffer* bb, uint64_t value);
+bool bb_put_svarint(BinBuffer* bb, int64_t value);
+
+BinReader bb_reader(BinBuffer* bb);
+BinReader br_create(const char* data, size_t length);
+size_t br_remaining(BinReader* br);
+bool br_ok(BinReader* br);
+bool br_skip(BinReader* br, size_t length);
+const char* br_bytes(BinReader* br, size_t length);    // advances, returned pointer aliases the source
+const char* br_peek(BinReader* br, size_t length);     // doesn't advance nor set error
+int br_peek_u8(BinReader* br);                          // -1 at end of data
+uint8_t br_u8(BinReader* br);
+uint16_t br_u16_le(BinReader* br);
+uint32_t br_u32_le(BinReader* br);
+uint64_t br_u64_le(BinReader* br);
+double br_f64_le(BinReader* br);
+uint16_t br_u16_be(BinReader* br);
+uint32_t br_u32_be(BinReader* br);
+uint64_t br_u64_be(BinReader* br);
+double br_f64_be(BinReader* br);
+uint64_t br_uvarint(BinReader* br);
+int64_t br_svarint(BinReader* br);
+
+ChunkedBinBuffer* cbb_create(size_t chunk_size);
+bool cbb_destroy(ChunkedBinBuffer* cbb);
+bool cbb_append(ChunkedBinBuffer* cbb, const char* data, size_t length);
+bool cbb_append_byte(ChunkedBinBuffer* cbb, char byte);
+char cbb_get_byte(ChunkedBinBuffer* cbb, size_t index);
+size_t cbb_chunk(ChunkedBinBuffer* cbb, size_t index, const char** data);  // returns used length of chunk
+BinBuffer* cbb_flatten(ChunkedBinBuffer* cbb);  // single copy into a new contiguous BinBuffer
+#ifdef BB_POSIX
+size_t cbb_iovecs(ChunkedBinBuffer* cbb, struct iovec* iov, size_t max_iov);    // returns number of filled iovecs
+#endif
+
+// searches start at `start` and return bb->length when nothing is found
+size_t bb_find_byte(BinBuffer* bb, size_t start, char byte);
+size_t bb_find_any(BinBuffer* bb, size_t start, const char* set, size_t set_length);    // vectorized for up to 16 bytes
+size_t bb_find_substr(BinBuffer* bb, size_t start, const char* needle, size_t needle_length);
+// yields records separated by delim (delimiter excluded), false once *pos reaches the end
+bool bb_next_record(BinBuffer* bb, size_t* pos, char delim, BinBufferView* record);
+
+// chainable: pass the previous result as crc, 0 to start
+uint32_t bb_crc32c_update(uint32_t crc, const char* data, size_t length);
+uint32_t bb_crc32c(BinBuffer* bb);
+// incremental CRC for append-only writers - only bytes added since the last call are read; shrink tracked
+// buffers with bb_truncate/bb_clear, assigning a smaller length directly leaves the running CRC stale
+void bb_crc32c_track(BinBuffer* bb, bool enable);
+uint32_t bb_crc32c_running(BinBuffer* bb);
+// fast non-cryptographic hash (XXH64, host byte order)
+uint64_t bb_hash64(BinBuffer* bb, uint64_t seed);
+
+// text encodings written straight into reserved space; decoders append nothing on invalid input
+bool bb_append_hex(BinBuffer* bb, const char* data, size_t length, bool uppercase);
+bool bb_append_from_hex(BinBuffer* bb, const char* text, size_t length);
+bool bb_append_base64(BinBuffer* bb, const char* data, size_t length);     // standard alphabet, padded
+bool bb_append_from_base64(BinBuffer* bb, const char* text, size_t length);
+
+// string building - formatted straight into spare capacity
+bool bb_appendf(BinBuffer* bb, const char* format, ...);
+bool bb_append_u64(BinBuffer* bb, uint64_t value);
+bool bb_append_i64(BinBuffer* bb, int64_t value);
+bool bb_append_f64(BinBuffer* bb, double value);  // shortest form that reads back to the same double
+const char* bb_cstr(BinBuffer* bb);     // NUL-terminates past length without counting it
+
+// LZ4 block compression; output is a uvarint of the original length followed by an LZ4 block
+size_t bb_compress_bound(size_t length);
+bool bb_compress(BinBuffer* dst, BinBuffer* src);      // appends to dst
+bool bb_decompress(BinBuffer* dst, BinBuffer* src);    // appends to dst, nothing on malformed input
+
+GapBinBuffer* gbb_create(size_t capacity);
+bool gbb_destroy(GapBinBuffer* gbb);
+size_t gbb_length(GapBinBuffer* gbb);
+bool gbb_insert(GapBinBuffer* gbb, size_t index, const char* data, size_t length);
+bool gbb_erase(GapBinBuffer* gbb, size_t index, size_t length);
+char gbb_get_byte(GapBinBuffer* gbb, size_t index);
+BinBuffer* gbb_collect(GapBinBuffer* gbb);  // closes the gap in place, also frees the GapBinBuffer
+
+#ifdef BB_POSIX
+// write everything, retrying on partial writes and EINTR
+bool bb_write_fd(BinBuffer* bb, int fd);
+bool bb_writev_fd(BinBuffer** bbs, size_t count, int fd);
+bool cbb_write_fd(ChunkedBinBuffer* cbb, int fd);
+// appends up to `length` bytes, returns like read(2)
+ssize_t bb_read_fd(BinBuffer* bb, int fd, size_t length);
+#endif
+
+#ifdef BB_POSIX
+// recycles BinBuffers by capacity; released buffers keep their data allocation
+BinBuffer* bb_pool_acquire(size_t capacity);
+void bb_pool_release(BinBuffer* bb);
+void bb_pool_trim(void);   // frees this thread's cache and the shared lists
+#endif
+
+#ifdef BB_LINUX
+BinRing* bbr_create(size_t capacity);  // rounded up to page size
+bool bbr_destroy(BinRing* ring);
+char* bbr_write_span(BinRing* ring, size_t* available);
+bool bbr_produce(BinRing* ring, size_t length);    // commits bytes written into the write span
+const char* bbr_read_span(BinRing* ring, size_t* available);
+bool bbr_consume(BinRing* ring, size_t length);
+bool bbr_write(BinRing* ring, const char* data, size_t length);
+
+// buffers must be left alone until their completion is polled. bbio_read reserves room up front, which may move
+// the buffer's data, so it fails with errno EBUSY for a BinBuffer that any request still in flight uses -
+// one outstanding read per buffer, and none while it is being written
+BinBufferIO* bbio_create(unsigned depth, bool allow_io_uring);
+bool bbio_destroy(BinBufferIO* io);    // waits for everything in flight
+bool bbio_write(BinBufferIO* io, int fd, BinBuffer* bb, uint64_t offset, uint64_t user_data);
+bool bbio_write_chunked(BinBufferIO* io, int fd, ChunkedBinBuffer* cbb, uint64_t offset, uint64_t user_data);
+bool bbio_read(BinBufferIO* io, int fd, BinBuffer* bb, size_t length, uint64_t offset, uint64_t user_data);  // appends
+int bbio_submit(BinBufferIO* io);     // hands all queued requests over in one go
+size_t bbio_poll(BinBufferIO* io, BinBufferIOCompletion* completions, size_t max, bool wait);
+size_t bbio_in_flight(BinBufferIO* io);
+
+// moves up to `length` bytes between current file offsets without passing them through user memory
+// (copy_file_range, then sendfile, then splice), copying through a BinBuffer only if the kernel refuses all three
+ssize_t bb_transfer_fd(int out_fd, int in_fd, size_t length);
+#endif
 
 #ifdef BB_IMPLEMENTATION
 
 BinBuffer* bb_create(size_t capacity) {
+    // small buffers get their storage in the same allocation; bb is the first member, so free(bb) releases both
+    if (capacity <= BB_INLINE_CAPACITY) {
+        BinBufferInline* ibb = (BinBufferInline*) malloc (sizeof(BinBufferInline));
+        if (!ibb) return NULL;
+        return bb_init_inline(ibb);
+    }
+
     BinBuffer* bb = (BinBuffer*) malloc (sizeof(BinBuffer));
     if (!bb) return NULL;
 
+    bb_init(bb);
     bb->data = (char*) malloc (capacity);
     if (!bb->data) {
         free(bb);
         return NULL;
     }
 
+    bb->capacity = capacity;
+
+    return bb;
+}
+
+BinBuffer* bb_init_inline(BinBufferInline* ibb) {
+    bb_init(&ibb->bb);
+    ibb->bb.data = ibb->inline_data;
+    ibb->bb.capacity = BB_INLINE_CAPACITY;
+    ibb->bb.storage = BB_STORAGE_INLINE;
+    return &ibb->bb;
+}
+
+void bb_init(BinBuffer* bb) {
+    bb->data = NULL;
     bb->length = 0;
+    bb->capacity = 0;
+    bb->storage = BB_STORAGE_HEAP;
+    bb->fd = -1;
+    bb->crc32c = 0;
+    bb->crc32c_length = 0;
+    bb->crc32c_tracking = false;
+#ifdef DEBUG
+    bb->generation = 0;
+#endif
+}
+
+BinBuffer* bb_adopt(char* data, size_t length, size_t capacity) {
+    if (!data || length > capacity) return NULL;
+
+    BinBuffer* bb = (BinBuffer*) malloc (sizeof(BinBuffer));
+    if (!bb) return NULL;
+
+    bb->data = data;
+    bb->length = length;
     bb->capacity = capacity;
+    bb->storage = BB_STORAGE_HEAP;
+    bb->fd = -1;
+    bb->crc32c = 0;
+    bb->crc32c_length = 0;
+    bb->crc32c_tracking = false;
+#ifdef DEBUG
+    bb->generation = 0;
+#endif
 
     return bb;
 }
 
 bool bb_destroy(BinBuffer* bb) {
     if (!bb) return false;
-    if (bb->data) free(bb->data);
+    bb_deinit(bb);
     free(bb);
     return true;
 }
 
+void bb_deinit(BinBuffer* bb) {
+    if (!bb) return;
+
+    if (bb->storage == BB_STORAGE_HEAP) {
+        if (bb->data) free(bb->data);
+    }
+#ifdef BB_POSIX
+    else if (bb->storage != BB_STORAGE_INLINE) {
+        if (bb->data) munmap(bb->data, bb->capacity);
+        if (bb->fd >= 0) {
+            if (ftruncate(bb->fd, bb->length) < 0) { /* nothing sensible left to do */ }
+            close(bb->fd);
+        }
+    }
+#endif
+
+    bb->data = NULL;
+    bb->length = 0;
+    bb->capacity = 0;
+    bb->storage = BB_STORAGE_HEAP;
+    bb->fd = -1;
+    bb->crc32c = 0;
+    bb->crc32c_length = 0;
+    bb->crc32c_tracking = false;
+}
+
 bool bb_append(BinBuffer* bb, const char* data, size_t length) {
     if (!data || length == 0 || !bb) return false;
 
-    if (bb->length + length > bb->capacity) {
-        if (!bb_expand(bb, 2 * bb->length)) return false;
-    }
+    if (!bb_reserve(bb, length)) return false;
 
     if (memcpy(bb->data + bb->length, data, length) == NULL) return false;
     bb->length += length;
+    if (bb->crc32c_tracking) bb_crc32c_running(bb);
 
     return true;
 }
@@ -68,31 +507,32 @@ bool bb_append(BinBuffer* bb, const char* data, size_t length) {
 bool bb_append_byte(BinBuffer* bb, char byte) {
     if (!bb) return false;
 
-    if (bb->length + 1 > bb->capacity) {
-        if (!bb_expand(bb, 2 * bb->length)) return false;
-    }
+    if (bb->length == bb->capacity && !bb_reserve(bb, 1)) return false;
 
     bb->data[bb->length] = byte;
     bb->length++;
+    if (bb->crc32c_tracking) bb_crc32c_running(bb);
 
     return true;
 }
 
 bool bb_set(BinBuffer* bb, size_t index, char* data, size_t length) {
     if (index + length > bb->capacity || !data || length == 0 || !bb) return false;
+    if (bb->storage == BB_STORAGE_MAP_READONLY) return false;
     if (memcpy(bb->data + index, data, length) == NULL) return false;
     return true;
 }
 
 bool bb_set_byte(BinBuffer* bb, size_t index, char byte) {
     if (index + 1 > bb->capacity || !bb) return false;
+    if (bb->storage == BB_STORAGE_MAP_READONLY) return false;
     bb->data[index] = byte;
     return true;
 }
 
 char* bb_get(BinBuffer* bb, size_t index, size_t requested_length) {
     size_t length = requested_length;
-    if (index + length > bb->capacity || !bb || length == 0) return NULL;
+    if (!bb || length == 0 || index > bb->length || length > bb->length - index) return NULL;
 
     char* data = (char*) malloc (length);
     if (!data) return NULL;
@@ -106,7 +546,7 @@ char* bb_get(BinBuffer* bb, size_t index, size_t requested_length) {
 }
 
 char bb_get_byte(BinBuffer* bb, size_t index) {
-    if (index >= bb->capacity || !bb) return 0;
+    if (!bb || index >= bb->length) return 0;
 
     return bb->data[index];
 }
@@ -127,15 +567,2694 @@ char* bb_collect(BinBuffer* bb) {
     return data;
 }
 
+char* bb_take(BinBuffer* bb, bool shrink) {
+    if (!bb) return NULL;
+    if (bb->storage != BB_STORAGE_HEAP) return bb_collect(bb);    // mappings can't be handed to free()
+
+    char* data = bb->data;
+    if (shrink && bb->length > 0 && bb->length < bb->capacity) {
+        char* shrunk = (char*) realloc (data, bb->length);
+        if (shrunk) data = shrunk;
+    }
+
+    free(bb);
+
+    return data;
+}
+
+BinBufferView bb_view(BinBuffer* bb, size_t index, size_t length) {
+    BinBufferView view = {0};
+    if (!bb || index > bb->length || length > bb->length - index) return view;
+
+    view.data = bb->data + index;
+    view.length = length;
+#ifdef DEBUG
+    view._bb = bb;
+    view._generation = bb->generation;
+#endif
+
+    return view;
+}
+
+bool bb_view_valid(BinBufferView view) {
+    if (!view.data) return false;
+#ifdef DEBUG
+    if (view._generation != view._bb->generation) return false;
+#endif
+    return true;
+}
+
+#ifdef BB_POSIX
+static char* _bb_grow_mapping(BinBuffer* bb, size_t new_capacity) {
+    if (bb->storage == BB_STORAGE_MAP_PRIVATE) {
+        // private mappings can't extend past the end of the file
+        char* data = (char*) malloc (new_capacity);
+        if (!data) return NULL;
+        memcpy(data, bb->data, bb->length);
+        munmap(bb->data, bb->capacity);
+        bb->storage = BB_STORAGE_HEAP;
+        return data;
+    }
+
+#ifdef BB_LINUX
+    if (bb->storage == BB_STORAGE_MAP_ANON || bb->storage == BB_STORAGE_MAP_HUGE) {
+        char* data = (char*) mremap (bb->data, bb->capacity, new_capacity, MREMAP_MAYMOVE);
+        if (data == MAP_FAILED) return NULL;
+        if (bb->storage == BB_STORAGE_MAP_HUGE) madvise(data, new_capacity, MADV_HUGEPAGE);
+        return data;
+    }
+#endif
+
+    if (bb->storage != BB_STORAGE_MAP_SHARED) return NULL;
+    if (ftruncate(bb->fd, new_capacity) < 0) return NULL;
+
+#ifdef BB_LINUX
+    char* data = (char*) mremap (bb->data, bb->capacity, new_capacity, MREMAP_MAYMOVE);
+#else
+    // map the grown file before dropping the old view, so a failure leaves bb->data valid
+    char* data = (char*) mmap (NULL, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, bb->fd, 0);
+    if (data != MAP_FAILED) munmap(bb->data, bb->capacity);
+#endif
+    if (data == MAP_FAILED) return NULL;
+
+    return data;
+}
+#endif
+
 bool bb_expand(BinBuffer* bb, size_t new_capacity) {
     if (new_capacity <= bb->capacity || !bb) return false;
 
-    bb->data = realloc(bb->data, new_capacity);
-    if (!bb->data) return false;
+    char* data = NULL;
+    if (bb->storage == BB_STORAGE_HEAP) {
+        data = (char*) realloc (bb->data, new_capacity);
+    } else if (bb->storage == BB_STORAGE_INLINE) {
+        data = (char*) malloc (new_capacity);
+        if (!data) return false;
+        memcpy(data, bb->data, bb->length);
+        bb->storage = BB_STORAGE_HEAP;
+    }
+#ifdef BB_POSIX
+    else {
+        // huge-page buffers grow in whole 2 MiB extents so the new tail can be THP-backed as well
+        size_t huge = (size_t) 2 << 20;
+        if (bb->storage == BB_STORAGE_MAP_HUGE && new_capacity <= SIZE_MAX - huge) {
+            new_capacity = (new_capacity + huge - 1) & ~(huge - 1);
+        }
+        data = _bb_grow_mapping(bb, new_capacity);
+    }
+#endif
+    if (!data) return false;
+    bb->data = data;
     bb->capacity = new_capacity;
+#ifdef DEBUG
+    bb->generation++;
+#endif
+
+    return true;
+}
+
+// rounds up to what malloc would hand out anyway: powers of two below a page, whole pages above
+static size_t _bb_size_class(size_t size) {
+    if (size <= 16) return 16;
+    if (size <= 4096) {
+        size_t size_class = 32;
+        while (size_class < size) size_class <<= 1;
+        return size_class;
+    }
+    if (size > SIZE_MAX - 4095) return size;
+    return (size + 4095) & ~(size_t) 4095;
+}
+
+bool bb_reserve(BinBuffer* bb, size_t additional) {
+    if (!bb) return false;
+    if (additional <= bb->capacity - bb->length) return true;
+    if (additional > SIZE_MAX - bb->length) return false;
+
+    size_t required = bb->length + additional;
+    size_t grown = bb->capacity <= SIZE_MAX / BB_GROWTH_NUM
+        ? bb->capacity * BB_GROWTH_NUM / BB_GROWTH_DEN
+        : SIZE_MAX;
+
+    return bb_expand(bb, _bb_size_class(grown > required ? grown : required));
+}
+
+char* bb_claim(BinBuffer* bb, size_t length) {
+    if (!bb) return NULL;
+    if (length > bb->capacity - bb->length && !bb_reserve(bb, length)) return NULL;
+
+    char* dst = bb->data + bb->length;
+    bb->length += length;
+
+    return dst;
+}
+
+// shrinking through here rather than assigning length keeps bb_crc32c_running from building on dropped bytes
+bool bb_truncate(BinBuffer* bb, size_t length) {
+    if (!bb || length > bb->length) return false;
+
+    bb->length = length;
+    if (bb->crc32c_length > length) {
+        bb->crc32c = 0;
+        bb->crc32c_length = 0;
+    }
+
+    return true;
+}
+
+void bb_clear(BinBuffer* bb) {
+    bb_truncate(bb, 0);
+}
+
+// shift-based so it's endian-independent; compilers fold these into single stores
+static char* _bb_store_le(char* dst, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) dst[i] = (char) (value >> (8 * i));
+    return dst + size;
+}
+
+static char* _bb_store_be(char* dst, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) dst[i] = (char) (value >> (8 * (size - 1 - i)));
+    return dst + size;
+}
+
+static uint64_t _bb_f64_bits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+char* bb_store_u16_le(char* dst, uint16_t value) { return _bb_store_le(dst, value, 2); }
+char* bb_store_u32_le(char* dst, uint32_t value) { return _bb_store_le(dst, value, 4); }
+char* bb_store_u64_le(char* dst, uint64_t value) { return _bb_store_le(dst, value, 8); }
+char* bb_store_f64_le(char* dst, double value) { return _bb_store_le(dst, _bb_f64_bits(value), 8); }
+char* bb_store_u16_be(char* dst, uint16_t value) { return _bb_store_be(dst, value, 2); }
+char* bb_store_u32_be(char* dst, uint32_t value) { return _bb_store_be(dst, value, 4); }
+char* bb_store_u64_be(char* dst, uint64_t value) { return _bb_store_be(dst, value, 8); }
+char* bb_store_f64_be(char* dst, double value) { return _bb_store_be(dst, _bb_f64_bits(value), 8); }
+
+char* bb_store_uvarint(char* dst, uint64_t value) {
+    while (value >= 0x80) {
+        *dst++ = (char) (value | 0x80);
+        value >>= 7;
+    }
+    *dst++ = (char) value;
+
+    return dst;
+}
+
+char* bb_store_svarint(char* dst, int64_t value) {
+    return bb_store_uvarint(dst, ((uint64_t) value << 1) ^ (uint64_t) (value >> 63));
+}
+
+bool bb_put_u16_le(BinBuffer* bb, uint16_t value) { char* dst = bb_claim(bb, 2); return dst && bb_store_u16_le(dst, value); }
+bool bb_put_u32_le(BinBuffer* bb, uint32_t value) { char* dst = bb_claim(bb, 4); return dst && bb_store_u32_le(dst, value); }
+bool bb_put_u64_le(BinBuffer* bb, uint64_t value) { char* dst = bb_claim(bb, 8); return dst && bb_store_u64_le(dst, value); }
+bool bb_put_f64_le(BinBuffer* bb, double value) { char* dst = bb_claim(bb, 8); return dst && bb_store_f64_le(dst, value); }
+bool bb_put_u16_be(BinBuffer* bb, uint16_t value) { char* dst = bb_claim(bb, 2); return dst && bb_store_u16_be(dst, value); }
+bool bb_put_u32_be(BinBuffer* bb, uint32_t value) { char* dst = bb_claim(bb, 4); return dst && bb_store_u32_be(dst, value); }
+bool bb_put_u64_be(BinBuffer* bb, uint64_t value) { char* dst = bb_claim(bb, 8); return dst && bb_store_u64_be(dst, value); }
+bool bb_put_f64_be(BinBuffer* bb, double value) { char* dst = bb_claim(bb, 8); return dst && bb_store_f64_be(dst, value); }
+
+bool bb_put_uvarint(BinBuffer* bb, uint64_t value) {
+    if (!bb || !bb_reserve(bb, BB_VARINT_MAX)) return false;
+    char* end = bb_store_uvarint(bb->data + bb->length, value);
+    bb->length = end - bb->data;
+    return true;
+}
+
+bool bb_put_svarint(BinBuffer* bb, int64_t value) {
+    if (!bb || !bb_reserve(bb, BB_VARINT_MAX)) return false;
+    char* end = bb_store_svarint(bb->data + bb->length, value);
+    bb->length = end - bb->data;
+    return true;
+}
+
+BinReader bb_reader(BinBuffer* bb) {
+    BinReader br = {0};
+    if (!bb) {
+        br.error = true;
+        return br;
+    }
+
+    br.data = bb->data;
+    br.length = bb->length;
+
+    return br;
+}
+
+BinReader br_create(const char* data, size_t length) {
+    BinReader br = {0};
+    if (!data && length > 0) {
+        br.error = true;
+        return br;
+    }
+
+    br.data = data;
+    br.length = length;
+
+    return br;
+}
+
+size_t br_remaining(BinReader* br) {
+    return br->error ? 0 : br->length - br->pos;
+}
+
+bool br_ok(BinReader* br) {
+    return !br->error;
+}
+
+// returns pointer to the next `size` bytes and advances, or NULL and sets error
+static const unsigned char* _br_take(BinReader* br, size_t size) {
+    if (br->error || size > br->length - br->pos) {
+        br->error = true;
+        return NULL;
+    }
+
+    const unsigned char* src = (const unsigned char*) br->data + br->pos;
+    br->pos += size;
+
+    return src;
+}
+
+bool br_skip(BinReader* br, size_t length) {
+    return _br_take(br, length) != NULL;
+}
+
+const char* br_bytes(BinReader* br, size_t length) {
+    return (const char*) _br_take(br, length);
+}
+
+const char* br_peek(BinReader* br, size_t length) {
+    if (br->error || length > br->length - br->pos) return NULL;
+    return br->data + br->pos;
+}
+
+int br_peek_u8(BinReader* br) {
+    if (br->error || br->pos == br->length) return -1;
+    return (unsigned char) br->data[br->pos];
+}
+
+static uint64_t _br_load_le(BinReader* br, size_t size) {
+    const unsigned char* src = _br_take(br, size);
+    if (!src) return 0;
+
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; i++) value |= (uint64_t) src[i] << (8 * i);
+    return value;
+}
+
+static uint64_t _br_load_be(BinReader* br, size_t size) {
+    const unsigned char* src = _br_take(br, size);
+    if (!src) return 0;
+
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; i++) value = (value << 8) | src[i];
+    return value;
+}
+
+static double _br_f64_from_bits(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint8_t br_u8(BinReader* br) { return (uint8_t) _br_load_le(br, 1); }
+uint16_t br_u16_le(BinReader* br) { return (uint16_t) _br_load_le(br, 2); }
+uint32_t br_u32_le(BinReader* br) { return (uint32_t) _br_load_le(br, 4); }
+uint64_t br_u64_le(BinReader* br) { return _br_load_le(br, 8); }
+double br_f64_le(BinReader* br) { return _br_f64_from_bits(_br_load_le(br, 8)); }
+uint16_t br_u16_be(BinReader* br) { return (uint16_t) _br_load_be(br, 2); }
+uint32_t br_u32_be(BinReader* br) { return (uint32_t) _br_load_be(br, 4); }
+uint64_t br_u64_be(BinReader* br) { return _br_load_be(br, 8); }
+double br_f64_be(BinReader* br) { return _br_f64_from_bits(_br_load_be(br, 8)); }
+
+uint64_t br_uvarint(BinReader* br) {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        const unsigned char* src = _br_take(br, 1);
+        if (!src) return 0;
+
+        value |= (uint64_t) (*src & 0x7f) << shift;
+        if (!(*src & 0x80)) return value;
+    }
+
+    br->error = true;   // more than BB_VARINT_MAX bytes
+    return 0;
+}
+
+int64_t br_svarint(BinReader* br) {
+    uint64_t value = br_uvarint(br);
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+ChunkedBinBuffer* cbb_create(size_t chunk_size) {
+    if (chunk_size == 0) return NULL;
+
+    ChunkedBinBuffer* cbb = (ChunkedBinBuffer*) malloc (sizeof(ChunkedBinBuffer));
+    if (!cbb) return NULL;
+
+    cbb->chunks = NULL;
+    cbb->chunk_count = 0;
+    cbb->chunk_slots = 0;
+    cbb->chunk_size = chunk_size;
+    cbb->length = 0;
+
+    return cbb;
+}
+
+bool cbb_destroy(ChunkedBinBuffer* cbb) {
+    if (!cbb) return false;
+    for (size_t i = 0; i < cbb->chunk_count; i++) free(cbb->chunks[i]);
+    free(cbb->chunks);
+    free(cbb);
+    return true;
+}
+
+static bool _cbb_add_chunk(ChunkedBinBuffer* cbb) {
+    if (cbb->chunk_count == cbb->chunk_slots) {
+        size_t slots = cbb->chunk_slots ? 2 * cbb->chunk_slots : 8;
+        char** chunks = (char**) realloc (cbb->chunks, slots * sizeof(char*));
+        if (!chunks) return false;
+        cbb->chunks = chunks;
+        cbb->chunk_slots = slots;
+    }
+
+    char* chunk = (char*) malloc (cbb->chunk_size);
+    if (!chunk) return false;
+    cbb->chunks[cbb->chunk_count++] = chunk;
+
+    return true;
+}
+
+bool cbb_append(ChunkedBinBuffer* cbb, const char* data, size_t length) {
+    if (!data || length == 0 || !cbb) return false;
+
+    while (length > 0) {
+        size_t used = cbb->length % cbb->chunk_size;
+        if (used == 0 && cbb->length == cbb->chunk_count * cbb->chunk_size) {
+            if (!_cbb_add_chunk(cbb)) return false;
+        }
+
+        size_t n = cbb->chunk_size - used;
+        if (n > length) n = length;
+
+        memcpy(cbb->chunks[cbb->chunk_count - 1] + used, data, n);
+        cbb->length += n;
+        data += n;
+        length -= n;
+    }
 
     return true;
 }
 
+bool cbb_append_byte(ChunkedBinBuffer* cbb, char byte) {
+    return cbb_append(cbb, &byte, 1);
+}
+
+char cbb_get_byte(ChunkedBinBuffer* cbb, size_t index) {
+    if (!cbb || index >= cbb->length) return 0;
+    return cbb->chunks[index / cbb->chunk_size][index % cbb->chunk_size];
+}
+
+size_t cbb_chunk(ChunkedBinBuffer* cbb, size_t index, const char** data) {
+    if (!cbb || index >= cbb->chunk_count) return 0;
+    if (data) *data = cbb->chunks[index];
+
+    if (index + 1 < cbb->chunk_count) return cbb->chunk_size;
+    return cbb->length - index * cbb->chunk_size;
+}
+
+BinBuffer* cbb_flatten(ChunkedBinBuffer* cbb) {
+    if (!cbb) return NULL;
+
+    BinBuffer* bb = bb_create(cbb->length);
+    if (!bb) return NULL;
+
+    for (size_t i = 0; i < cbb->chunk_count; i++) {
+        const char* data;
+        size_t length = cbb_chunk(cbb, i, &data);
+        memcpy(bb->data + bb->length, data, length);
+        bb->length += length;
+    }
+
+    return bb;
+}
+
+#ifdef BB_POSIX
+size_t cbb_iovecs(ChunkedBinBuffer* cbb, struct iovec* iov, size_t max_iov) {
+    if (!cbb || !iov) return 0;
+
+    size_t count = 0;
+    for (; count < cbb->chunk_count && count < max_iov; count++) {
+        const char* data;
+        iov[count].iov_len = cbb_chunk(cbb, count, &data);
+        iov[count].iov_base = (void*) data;
+    }
+
+    return count;
+}
+#endif
+
+// CRC-32C (Castagnoli), reflected polynomial
+#define _BB_CRC32C_POLY 0x82f63b78u
+#define _BB_CRC32C_LONG 8192
+#define _BB_CRC32C_SHORT 256
+
+static uint32_t _bb_crc32c_table[256];
+// operators appending LONG/SHORT zero bytes to a crc, used to join interleaved streams
+static uint32_t _bb_crc32c_long[4][256];
+static uint32_t _bb_crc32c_short[4][256];
+#ifdef BB_POSIX
+static pthread_once_t _bb_crc32c_once = PTHREAD_ONCE_INIT;
+#else
+static bool _bb_crc32c_ready;
+#endif
+
+static uint32_t _bb_gf2_times(const uint32_t* mat, uint32_t vec) {
+    uint32_t sum = 0;
+    for (; vec; vec >>= 1, mat++) {
+        if (vec & 1) sum ^= *mat;
+    }
+    return sum;
+}
+
+static void _bb_gf2_square(uint32_t* square, const uint32_t* mat) {
+    for (int n = 0; n < 32; n++) square[n] = _bb_gf2_times(mat, mat[n]);
+}
+
+static void _bb_crc32c_zeros(uint32_t zeros[4][256], size_t length) {
+    uint32_t even[32], odd[32];
+
+    // operator for one zero bit, then square up to one zero byte and on to `length` bytes
+    odd[0] = _BB_CRC32C_POLY;
+    for (int n = 1; n < 32; n++) odd[n] = (uint32_t) 1 << (n - 1);
+    _bb_gf2_square(even, odd);
+    _bb_gf2_square(odd, even);
+
+    uint32_t* op = odd;
+    do {
+        _bb_gf2_square(even, odd);
+        length >>= 1;
+        op = even;
+        if (length == 0) break;
+        _bb_gf2_square(odd, even);
+        length >>= 1;
+        op = odd;
+    } while (length);
+
+    for (uint32_t n = 0; n < 256; n++) {
+        zeros[0][n] = _bb_gf2_times(op, n);
+        zeros[1][n] = _bb_gf2_times(op, n << 8);
+        zeros[2][n] = _bb_gf2_times(op, n << 16);
+        zeros[3][n] = _bb_gf2_times(op, n << 24);
+    }
+}
+
+static uint32_t _bb_crc32c_shift(uint32_t zeros[4][256], uint32_t crc) {
+    return zeros[0][crc & 0xff] ^ zeros[1][(crc >> 8) & 0xff] ^ zeros[2][(crc >> 16) & 0xff] ^ zeros[3][crc >> 24];
+}
+
+static void _bb_crc32c_build(void) {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t crc = n;
+        for (int k = 0; k < 8; k++) crc = crc & 1 ? (crc >> 1) ^ _BB_CRC32C_POLY : crc >> 1;
+        _bb_crc32c_table[n] = crc;
+    }
+    _bb_crc32c_zeros(_bb_crc32c_long, _BB_CRC32C_LONG);
+    _bb_crc32c_zeros(_bb_crc32c_short, _BB_CRC32C_SHORT);
+}
+
+// built on first use; the tables must be fully visible before any thread reads them
+static void _bb_crc32c_init(void) {
+#ifdef BB_POSIX
+    pthread_once(&_bb_crc32c_once, _bb_crc32c_build);
+#elif defined(__GNUC__)
+    // racing builders write identical values; the release store publishes them
+    if (__atomic_load_n(&_bb_crc32c_ready, __ATOMIC_ACQUIRE)) return;
+    _bb_crc32c_build();
+    __atomic_store_n(&_bb_crc32c_ready, true, __ATOMIC_RELEASE);
+#else
+    // no threads or atomics to rely on: the first bb_crc32c call must happen before threads share it
+    if (_bb_crc32c_ready) return;
+    _bb_crc32c_build();
+    _bb_crc32c_ready = true;
+#endif
+}
+
+static uint32_t _bb_crc32c_sw(uint32_t crc, const unsigned char* data, size_t length) {
+    crc = ~crc;
+    while (length--) crc = (crc >> 8) ^ _bb_crc32c_table[(crc ^ *data++) & 0xff];
+    return ~crc;
+}
+
+#ifdef BB_X86
+static bool _bb_has_sse42(void) {
+    // relaxed atomics: threads may race to fill it in, but only ever with the same answer
+    static int cached = -1;
+    int supported = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+    if (supported < 0) {
+        __builtin_cpu_init();
+        supported = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+        __atomic_store_n(&cached, supported, __ATOMIC_RELAXED);
+    }
+    return supported;
+}
+
+// three independent crc32 streams hide the instruction's 3 cycle latency
+__attribute__((target("sse4.2")))
+static uint32_t _bb_crc32c_hw(uint32_t crc, const unsigned char* data, size_t length) {
+    uint64_t crc0 = ~crc;
+
+    while (length > 0 && ((uintptr_t) data & 7) != 0) {
+        crc0 = _mm_crc32_u8((uint32_t) crc0, *data++);
+        length--;
+    }
+
+    while (length >= 3 * _BB_CRC32C_LONG) {
+        uint64_t crc1 = 0, crc2 = 0;
+        const unsigned char* end = data + _BB_CRC32C_LONG;
+        do {
+            uint64_t a, b, c;
+            memcpy(&a, data, 8);
+            memcpy(&b, data + _BB_CRC32C_LONG, 8);
+            memcpy(&c, data + 2 * _BB_CRC32C_LONG, 8);
+            crc0 = _mm_crc32_u64(crc0, a);
+            crc1 = _mm_crc32_u64(crc1, b);
+            crc2 = _mm_crc32_u64(crc2, c);
+            data += 8;
+        } while (data < end);
+        crc0 = _bb_crc32c_shift(_bb_crc32c_long, (uint32_t) crc0) ^ crc1;
+        crc0 = _bb_crc32c_shift(_bb_crc32c_long, (uint32_t) crc0) ^ crc2;
+        data += 2 * _BB_CRC32C_LONG;
+        length -= 3 * _BB_CRC32C_LONG;
+    }
+
+    while (length >= 3 * _BB_CRC32C_SHORT) {
+        uint64_t crc1 = 0, crc2 = 0;
+        const unsigned char* end = data + _BB_CRC32C_SHORT;
+        do {
+            uint64_t a, b, c;
+            memcpy(&a, data, 8);
+            memcpy(&b, data + _BB_CRC32C_SHORT, 8);
+            memcpy(&c, data + 2 * _BB_CRC32C_SHORT, 8);
+            crc0 = _mm_crc32_u64(crc0, a);
+            crc1 = _mm_crc32_u64(crc1, b);
+            crc2 = _mm_crc32_u64(crc2, c);
+            data += 8;
+        } while (data < end);
+        crc0 = _bb_crc32c_shift(_bb_crc32c_short, (uint32_t) crc0) ^ crc1;
+        crc0 = _bb_crc32c_shift(_bb_crc32c_short, (uint32_t) crc0) ^ crc2;
+        data += 2 * _BB_CRC32C_SHORT;
+        length -= 3 * _BB_CRC32C_SHORT;
+    }
+
+    while (length >= 8) {
+        uint64_t a;
+        memcpy(&a, data, 8);
+        crc0 = _mm_crc32_u64(crc0, a);
+        data += 8;
+        length -= 8;
+    }
+
+    while (length--) crc0 = _mm_crc32_u8((uint32_t) crc0, *data++);
+
+    return ~(uint32_t) crc0;
+}
+#endif
+
+uint32_t bb_crc32c_update(uint32_t crc, const char* data, size_t length) {
+    if (!data) return crc;
+    _bb_crc32c_init();
+
+#ifdef BB_X86
+    if (_bb_has_sse42()) return _bb_crc32c_hw(crc, (const unsigned char*) data, length);
+#endif
+    return _bb_crc32c_sw(crc, (const unsigned char*) data, length);
+}
+
+uint32_t bb_crc32c(BinBuffer* bb) {
+    if (!bb) return 0;
+    return bb_crc32c_update(0, bb->data, bb->length);
+}
+
+void bb_crc32c_track(BinBuffer* bb, bool enable) {
+    if (!bb) return;
+    bb->crc32c_tracking = enable;
+    if (enable) bb_crc32c_running(bb);
+}
+
+uint32_t bb_crc32c_running(BinBuffer* bb) {
+    if (!bb) return 0;
+
+    // shrunk since last time - nothing to build on
+    if (bb->crc32c_length > bb->length) {
+        bb->crc32c = 0;
+        bb->crc32c_length = 0;
+    }
+
+    bb->crc32c = bb_crc32c_update(bb->crc32c, bb->data + bb->crc32c_length, bb->length - bb->crc32c_length);
+    bb->crc32c_length = bb->length;
+
+    return bb->crc32c;
+}
+
+#define _BB_XXH_P1 0x9E3779B185EBCA87ULL
+#define _BB_XXH_P2 0xC2B2AE3D27D4EB4FULL
+#define _BB_XXH_P3 0x165667B19E3779F9ULL
+#define _BB_XXH_P4 0x85EBCA77C2B2CA63ULL
+#define _BB_XXH_P5 0x27D4EB2F165667C5ULL
+
+static uint64_t _bb_rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t _bb_xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * _BB_XXH_P2;
+    return _bb_rotl64(acc, 31) * _BB_XXH_P1;
+}
+
+static uint64_t _bb_xxh_merge(uint64_t acc, uint64_t value) {
+    acc ^= _bb_xxh_round(0, value);
+    return acc * _BB_XXH_P1 + _BB_XXH_P4;
+}
+
+uint64_t bb_hash64(BinBuffer* bb, uint64_t seed) {
+    if (!bb) return 0;
+
+    const char* p = bb->data;
+    size_t length = bb->length;
+    const char* end = p + length;
+    uint64_t h, word;
+
+    if (length >= 32) {
+        uint64_t v1 = seed + _BB_XXH_P1 + _BB_XXH_P2, v2 = seed + _BB_XXH_P2, v3 = seed, v4 = seed - _BB_XXH_P1;
+        do {
+            memcpy(&word, p, 8); v1 = _bb_xxh_round(v1, word);
+            memcpy(&word, p + 8, 8); v2 = _bb_xxh_round(v2, word);
+            memcpy(&word, p + 16, 8); v3 = _bb_xxh_round(v3, word);
+            memcpy(&word, p + 24, 8); v4 = _bb_xxh_round(v4, word);
+            p += 32;
+        } while (end - p >= 32);
+
+        h = _bb_rotl64(v1, 1) + _bb_rotl64(v2, 7) + _bb_rotl64(v3, 12) + _bb_rotl64(v4, 18);
+        h = _bb_xxh_merge(h, v1);
+        h = _bb_xxh_merge(h, v2);
+        h = _bb_xxh_merge(h, v3);
+        h = _bb_xxh_merge(h, v4);
+    } else {
+        h = seed + _BB_XXH_P5;
+    }
+
+    h += length;
+
+    for (; end - p >= 8; p += 8) {
+        memcpy(&word, p, 8);
+        h ^= _bb_xxh_round(0, word);
+        h = _bb_rotl64(h, 27) * _BB_XXH_P1 + _BB_XXH_P4;
+    }
+
+    if (end - p >= 4) {
+        uint32_t half;
+        memcpy(&half, p, 4);
+        h ^= (uint64_t) half * _BB_XXH_P1;
+        h = _bb_rotl64(h, 23) * _BB_XXH_P2 + _BB_XXH_P3;
+        p += 4;
+    }
+
+    for (; p < end; p++) {
+        h ^= (uint64_t) (unsigned char) *p * _BB_XXH_P5;
+        h = _bb_rotl64(h, 11) * _BB_XXH_P1;
+    }
+
+    h ^= h >> 33;
+    h *= _BB_XXH_P2;
+    h ^= h >> 29;
+    h *= _BB_XXH_P3;
+    h ^= h >> 32;
+
+    return h;
+}
+
+#ifdef BB_X86
+static bool _bb_has_ssse3(void) {
+    // relaxed atomics: threads may race to fill it in, but only ever with the same answer
+    static int cached = -1;
+    int supported = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+    if (supported < 0) {
+        __builtin_cpu_init();
+        supported = __builtin_cpu_supports("ssse3") ? 1 : 0;
+        __atomic_store_n(&cached, supported, __ATOMIC_RELAXED);
+    }
+    return supported;
+}
+#endif
+
+// 0-15 for hex digits, -1 otherwise
+static int _bb_hex_value(unsigned char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+bool bb_append_hex(BinBuffer* bb, const char* data, size_t length, bool uppercase) {
+    if (!bb || (!data && length > 0)) return false;
+    if (length > SIZE_MAX / 2) return false;
+
+    char* dst = bb_claim(bb, 2 * length);
+    if (!dst) return false;
+
+    const char* digits = uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+    size_t i = 0;
+#ifdef BB_X86
+    // nibbles become '0' + n, plus the gap up to 'a'/'A' for n > 9
+    const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i letter_gap = _mm_set1_epi8(uppercase ? 'A' - '0' - 10 : 'a' - '0' - 10);
+    for (; i + 16 <= length; i += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i*) (data + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 4), nibble_mask);
+        __m128i lo = _mm_and_si128(in, nibble_mask);
+
+        __m128i first = _mm_unpacklo_epi8(hi, lo);
+        __m128i second = _mm_unpackhi_epi8(hi, lo);
+        first = _mm_add_epi8(_mm_add_epi8(first, zero_char), _mm_and_si128(_mm_cmpgt_epi8(first, nine), letter_gap));
+        second = _mm_add_epi8(_mm_add_epi8(second, zero_char), _mm_and_si128(_mm_cmpgt_epi8(second, nine), letter_gap));
+
+        _mm_storeu_si128((__m128i*) (dst + 2 * i), first);
+        _mm_storeu_si128((__m128i*) (dst + 2 * i + 16), second);
+    }
+#endif
+    for (; i < length; i++) {
+        unsigned char byte = (unsigned char) data[i];
+        dst[2 * i] = digits[byte >> 4];
+        dst[2 * i + 1] = digits[byte & 0x0f];
+    }
+
+    return true;
+}
+
+bool bb_append_from_hex(BinBuffer* bb, const char* text, size_t length) {
+    if (!bb || (!text && length > 0) || length % 2 != 0) return false;
+
+    size_t old_length = bb->length;
+    char* dst = bb_claim(bb, length / 2);
+    if (!dst) return false;
+
+    size_t i = 0;
+#ifdef BB_X86
+    const __m128i below_zero = _mm_set1_epi8('0' - 1);
+    const __m128i above_nine = _mm_set1_epi8('9' + 1);
+    const __m128i below_a = _mm_set1_epi8('a' - 1);
+    const __m128i above_f = _mm_set1_epi8('f' + 1);
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i low_byte = _mm_set1_epi16(0x00ff);
+    for (; i + 16 <= length; i += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i*) (text + i));
+        __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(in, below_zero), _mm_cmpgt_epi8(above_nine, in));
+        __m128i folded = _mm_or_si128(in, lower);
+        __m128i is_letter = _mm_and_si128(_mm_cmpgt_epi8(folded, below_a), _mm_cmpgt_epi8(above_f, folded));
+        if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) != 0xffff) break;
+
+        __m128i values = _mm_or_si128(
+            _mm_and_si128(is_digit, _mm_sub_epi8(in, _mm_set1_epi8('0'))),
+            _mm_and_si128(is_letter, _mm_sub_epi8(folded, _mm_set1_epi8('a' - 10))));
+
+        // first character of each pair sits in the low byte of a 16-bit lane
+        __m128i hi = _mm_slli_epi16(_mm_and_si128(values, low_byte), 4);
+        __m128i lo = _mm_srli_epi16(values, 8);
+        __m128i bytes = _mm_packus_epi16(_mm_or_si128(hi, lo), _mm_setzero_si128());
+        _mm_storel_epi64((__m128i*) (dst + i / 2), bytes);
+    }
+#endif
+    for (; i < length; i += 2) {
+        int hi = _bb_hex_value((unsigned char) text[i]);
+        int lo = _bb_hex_value((unsigned char) text[i + 1]);
+        if (hi < 0 || lo < 0) {
+            bb_truncate(bb, old_length);
+            return false;
+        }
+        dst[i / 2] = (char) (hi << 4 | lo);
+    }
+
+    return true;
+}
+
+static const char _bb_base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static int _bb_base64_value(unsigned char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+#ifdef BB_X86
+// 12 input bytes -> 16 characters per step, reads 16 bytes (see W. Mula, D. Lemire, "Faster Base64 Encoding and Decoding Using AVX2 Instructions")
+__attribute__((target("ssse3")))
+static size_t _bb_base64_encode_ssse3(char* dst, const unsigned char* src, size_t length) {
+    const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i shift_lut = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 12) {
+        __m128i in = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (src + i)), shuffle);
+
+        // split every 3 bytes into four 6-bit indices, one per output byte
+        __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+        __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+        __m128i indices = _mm_or_si128(t0, t1);
+
+        __m128i lut_index = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+        lut_index = _mm_or_si128(lut_index, _mm_and_si128(less, _mm_set1_epi8(13)));
+        __m128i out = _mm_add_epi8(_mm_shuffle_epi8(shift_lut, lut_index), indices);
+
+        _mm_storeu_si128((__m128i*) (dst + i / 3 * 4), out);
+    }
+
+    return i;
+}
+
+// 16 characters -> 12 bytes per step, writes 16; stops at the first block with anything but alphabet characters
+__attribute__((target("ssse3")))
+static size_t _bb_base64_decode_ssse3(char* dst, const char* src, size_t length) {
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i*) (src + i));
+        __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(in, 4), nibble_mask);
+        __m128i lo_nibbles = _mm_and_si128(in, nibble_mask);
+
+        __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+        __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128()))) break;
+
+        __m128i is_slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+        __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(is_slash, hi_nibbles));
+        __m128i values = _mm_add_epi8(in, roll);
+
+        __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128((__m128i*) (dst + i / 4 * 3), _mm_shuffle_epi8(merged, pack));
+    }
+
+    return i;
+}
+#endif
+
+bool bb_append_base64(BinBuffer* bb, const char* data, size_t length) {
+    if (!bb || (!data && length > 0)) return false;
+    if (length / 3 >= SIZE_MAX / 4 - 1) return false;
+
+    size_t out_length = (length + 2) / 3 * 4;
+    char* dst = bb_claim(bb, out_length);
+    if (!dst) return false;
+
+    const unsigned char* src = (const unsigned char*) data;
+    size_t i = 0;
+#ifdef BB_X86
+    if (_bb_has_ssse3()) i = _bb_base64_encode_ssse3(dst, src, length);
+#endif
+    char* out = dst + i / 3 * 4;
+    for (; i + 3 <= length; i += 3) {
+        uint32_t triple = (uint32_t) src[i] << 16 | (uint32_t) src[i + 1] << 8 | src[i + 2];
+        *out++ = _bb_base64_alphabet[triple >> 18];
+        *out++ = _bb_base64_alphabet[(triple >> 12) & 0x3f];
+        *out++ = _bb_base64_alphabet[(triple >> 6) & 0x3f];
+        *out++ = _bb_base64_alphabet[triple & 0x3f];
+    }
+
+    if (i < length) {
+        uint32_t triple = (uint32_t) src[i] << 16 | (i + 1 < length ? (uint32_t) src[i + 1] << 8 : 0);
+        *out++ = _bb_base64_alphabet[triple >> 18];
+        *out++ = _bb_base64_alphabet[(triple >> 12) & 0x3f];
+        *out++ = i + 1 < length ? _bb_base64_alphabet[(triple >> 6) & 0x3f] : '=';
+        *out++ = '=';
+    }
+
+    return true;
+}
+
+bool bb_append_from_base64(BinBuffer* bb, const char* text, size_t length) {
+    if (!bb || (!text && length > 0) || length % 4 != 0) return false;
+    if (length == 0) return true;
+
+    size_t padding = text[length - 1] == '=' ? (text[length - 2] == '=' ? 2 : 1) : 0;
+    size_t old_length = bb->length;
+
+    // +4 for the SIMD path's 16 byte stores
+    if (!bb_reserve(bb, length / 4 * 3 + 4)) return false;
+    char* dst = bb->data + bb->length;
+
+    size_t i = 0;
+#ifdef BB_X86
+    if (_bb_has_ssse3()) i = _bb_base64_decode_ssse3(dst, text, length - 4);
+#endif
+    char* out = dst + i / 4 * 3;
+    for (; i < length; i += 4) {
+        bool last = i + 4 == length;
+        int v0 = _bb_base64_value((unsigned char) text[i]);
+        int v1 = _bb_base64_value((unsigned char) text[i + 1]);
+        int v2 = last && padding == 2 ? 0 : _bb_base64_value((unsigned char) text[i + 2]);
+        int v3 = last && padding >= 1 ? 0 : _bb_base64_value((unsigned char) text[i + 3]);
+        if (v0 < 0 || v1 < 0 || v2 < 0 || v3 < 0) {
+            bb_truncate(bb, old_length);
+            return false;
+        }
+
+        uint32_t quad = (uint32_t) v0 << 18 | (uint32_t) v1 << 12 | (uint32_t) v2 << 6 | (uint32_t) v3;
+        *out++ = (char) (quad >> 16);
+        *out++ = (char) (quad >> 8);
+        *out++ = (char) quad;
+    }
+
+    bb->length += length / 4 * 3 - padding;
+
+    return true;
+}
+
+bool bb_appendf(BinBuffer* bb, const char* format, ...) {
+    if (!bb || !format) return false;
+
+    va_list args, retry;
+    va_start(args, format);
+    va_copy(retry, args);
+
+    size_t spare = bb->capacity - bb->length;
+    int n = vsnprintf(spare ? bb->data + bb->length : NULL, spare, format, args);
+    va_end(args);
+
+    // didn't fit (vsnprintf needs room for the NUL too) - grow once and format again
+    if (n >= 0 && (size_t) n >= spare) {
+        if (!bb_reserve(bb, (size_t) n + 1)) n = -1;
+        else n = vsnprintf(bb->data + bb->length, (size_t) n + 1, format, retry);
+    }
+    va_end(retry);
+
+    if (n < 0) return false;
+    bb->length += n;
+
+    return true;
+}
+
+static const char _bb_digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static int _bb_count_digits(uint64_t value) {
+    int digits = 1;
+    for (uint64_t bound = 10; digits < 20 && value >= bound; bound *= 10) digits++;
+    return digits;
+}
+
+// writes exactly `digits` characters, two at a time from the back
+static void _bb_write_u64(char* dst, uint64_t value, int digits) {
+    char* p = dst + digits;
+    while (value >= 100) {
+        unsigned pair = (unsigned) (value % 100) * 2;
+        value /= 100;
+        *--p = _bb_digit_pairs[pair + 1];
+        *--p = _bb_digit_pairs[pair];
+    }
+    if (value >= 10) {
+        *--p = _bb_digit_pairs[value * 2 + 1];
+        *--p = _bb_digit_pairs[value * 2];
+    } else {
+        *--p = (char) ('0' + value);
+    }
+}
+
+bool bb_append_u64(BinBuffer* bb, uint64_t value) {
+    int digits = _bb_count_digits(value);
+    char* dst = bb_claim(bb, digits);
+    if (!dst) return false;
+
+    _bb_write_u64(dst, value, digits);
+    return true;
+}
+
+bool bb_append_i64(BinBuffer* bb, int64_t value) {
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+    int digits = _bb_count_digits(magnitude);
+    char* dst = bb_claim(bb, digits + (value < 0));
+    if (!dst) return false;
+
+    if (value < 0) *dst++ = '-';
+    _bb_write_u64(dst, magnitude, digits);
+    return true;
+}
+
+/* Grisu2 (F. Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers"), after
+ * Milo Yip's implementation. Always round-trips, and yields the shortest digits for all but a tiny
+ * fraction of inputs. */
+typedef struct {
+    uint64_t f;
+    int e;
+} _BBDiyFp;
+
+// normalized 10^k for k = -348, -340, ..., 340
+static const uint64_t _bb_cached_powers_f[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL, 0xcf42894a5dce35eaULL,
+    0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL, 0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL,
+    0xbe5691ef416bd60cULL, 0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL, 0xc21094364dfb5637ULL,
+    0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL, 0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL,
+    0xb23867fb2a35b28eULL, 0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL, 0xb5b5ada8aaff80b8ULL,
+    0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL, 0x964e858c91ba2655ULL, 0xdff9772470297ebdULL,
+    0xa6dfbd9fb8e5b88fULL, 0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL, 0xaa242499697392d3ULL,
+    0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL, 0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL,
+    0x9c40000000000000ULL, 0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL, 0x9f4f2726179a2245ULL,
+    0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL, 0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL,
+    0x924d692ca61be758ULL, 0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL, 0x952ab45cfa97a0b3ULL,
+    0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL, 0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL,
+    0x88fcf317f22241e2ULL, 0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL, 0x8bab8eefb6409c1aULL,
+    0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL, 0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL,
+    0x80444b5e7aa7cf85ULL, 0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+
+static const int16_t _bb_cached_powers_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927, -901, -874, -847, -821,
+    -794, -768, -741, -715, -688, -661, -635, -608, -582, -555, -529, -502, -475, -449, -422, -396,
+    -369, -343, -316, -289, -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348, 375, 402, 428, 455,
+    481, 508, 534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066
+};
+
+static const uint64_t _bb_pow10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+    1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static _BBDiyFp _bb_diyfp_multiply(_BBDiyFp x, _BBDiyFp y) {
+    const uint64_t m32 = 0xffffffffULL;
+    uint64_t a = x.f >> 32, b = x.f & m32, c = y.f >> 32, d = y.f & m32;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & m32) + (bc & m32) + (1ULL << 31);
+
+    _BBDiyFp r = { ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64 };
+    return r;
+}
+
+static _BBDiyFp _bb_diyfp_normalize(_BBDiyFp x) {
+    while (!(x.f & (1ULL << 63))) {
+        x.f <<= 1;
+        x.e--;
+    }
+    return x;
+}
+
+static void _bb_grisu_round(char* buffer, int length, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t wp_w) {
+    while (rest < wp_w && delta - rest >= ten_kappa &&
+           (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+        buffer[length - 1]--;
+        rest += ten_kappa;
+    }
+}
+
+static void _bb_grisu_digits(_BBDiyFp w, _BBDiyFp mp, uint64_t delta, char* buffer, int* length, int* k) {
+    _BBDiyFp one = { 1ULL << -mp.e, mp.e };
+    uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t) (mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = _bb_count_digits(p1);
+    *length = 0;
+
+    while (kappa > 0) {
+        uint32_t d = p1 / (uint32_t) _bb_pow10[kappa - 1];
+        p1 %= (uint32_t) _bb_pow10[kappa - 1];
+        if (d || *length) buffer[(*length)++] = (char) ('0' + d);
+        kappa--;
+
+        uint64_t rest = ((uint64_t) p1 << -one.e) + p2;
+        if (rest <= delta) {
+            *k += kappa;
+            _bb_grisu_round(buffer, *length, delta, rest, _bb_pow10[kappa] << -one.e, wp_w);
+            return;
+        }
+    }
+
+    for (;;) {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char) (p2 >> -one.e);
+        if (d || *length) buffer[(*length)++] = (char) ('0' + d);
+        p2 &= one.f - 1;
+        kappa--;
+
+        if (p2 < delta) {
+            *k += kappa;
+            _bb_grisu_round(buffer, *length, delta, p2, one.f, wp_w * (-kappa < 20 ? _bb_pow10[-kappa] : 0));
+            return;
+        }
+    }
+}
+
+// value must be finite and positive; digits * 10^k == value
+static void _bb_grisu2(double value, char* buffer, int* length, int* k) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint64_t hidden = 1ULL << 52;
+    int biased = (int) ((bits >> 52) & 0x7ff);
+    _BBDiyFp v;
+    v.f = bits & (hidden - 1);
+    if (biased) {
+        v.f += hidden;
+        v.e = biased - 1075;
+    } else {
+        v.e = -1074;
+    }
+
+    // boundaries halfway to the neighbouring doubles
+    _BBDiyFp plus = { (v.f << 1) + 1, v.e - 1 };
+    while (!(plus.f & (hidden << 1))) {
+        plus.f <<= 1;
+        plus.e--;
+    }
+    plus.f <<= 10;
+    plus.e -= 10;
+
+    _BBDiyFp minus = v.f == hidden ? (_BBDiyFp) { (v.f << 2) - 1, v.e - 2 } : (_BBDiyFp) { (v.f << 1) - 1, v.e - 1 };
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    // pick a cached 10^-k that brings the exponent into [-60, -32]
+    double dk = (-61 - plus.e) * 0.30102999566398114 + 347;
+    int kk = (int) dk;
+    if (dk - kk > 0.0) kk++;
+    unsigned index = (unsigned) ((kk >> 3) + 1);
+    *k = -(-348 + (int) index * 8);
+    _BBDiyFp c_mk = { _bb_cached_powers_f[index], _bb_cached_powers_e[index] };
+
+    _BBDiyFp w = _bb_diyfp_multiply(_bb_diyfp_normalize(v), c_mk);
+    _BBDiyFp wp = _bb_diyfp_multiply(plus, c_mk);
+    _BBDiyFp wm = _bb_diyfp_multiply(minus, c_mk);
+    wm.f++;
+    wp.f--;
+
+    _bb_grisu_digits(w, wp, wp.f - wm.f, buffer, length, k);
+}
+
+bool bb_append_f64(BinBuffer* bb, double value) {
+    if (!bb) return false;
+    if (isnan(value)) return bb_append(bb, "nan", 3);
+    if (isinf(value)) return value > 0 ? bb_append(bb, "inf", 3) : bb_append(bb, "-inf", 4);
+
+    // sign, 17 digits, up to 21 leading/trailing zeros or an exponent, point
+    char* dst = bb_claim(bb, 32);
+    if (!dst) return false;
+    char* p = dst;
+
+    if (signbit(value)) {
+        *p++ = '-';
+        value = -value;
+    }
+
+    if (value == 0.0) {
+        *p++ = '0';
+        bb_truncate(bb, bb->length - (32 - (p - dst)));
+        return true;
+    }
+
+    char digits[20];
+    int length, k;
+    _bb_grisu2(value, digits, &length, &k);
+    int point = length + k;     // position of the decimal point relative to the digits
+
+    if (k >= 0 && point <= 21) {
+        // integer: 1234e2 -> 123400
+        memcpy(p, digits, length);
+        memset(p + length, '0', k);
+        p += point;
+    } else if (point > 0 && point <= 21) {
+        // 1234e-2 -> 12.34
+        memcpy(p, digits, point);
+        p[point] = '.';
+        memcpy(p + point + 1, digits + point, length - point);
+        p += length + 1;
+    } else if (point > -6 && point <= 0) {
+        // 1234e-6 -> 0.001234
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', -point);
+        memcpy(p - point, digits, length);
+        p += length - point;
+    } else {
+        // 1234e30 -> 1.234e33
+        *p++ = digits[0];
+        if (length > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, length - 1);
+            p += length - 1;
+        }
+        int exponent = point - 1;
+        *p++ = 'e';
+        if (exponent < 0) {
+            *p++ = '-';
+            exponent = -exponent;
+        }
+        int exponent_digits = _bb_count_digits((uint64_t) exponent);
+        _bb_write_u64(p, (uint64_t) exponent, exponent_digits);
+        p += exponent_digits;
+    }
+
+    bb_truncate(bb, bb->length - (32 - (p - dst)));
+    return true;
+}
+
+const char* bb_cstr(BinBuffer* bb) {
+    if (!bb) return NULL;
+    if (bb->length == bb->capacity && !bb_reserve(bb, 1)) return NULL;
+
+    bb->data[bb->length] = '\0';
+    return bb->data;
+}
+
+#define _BB_LZ4_MIN_MATCH 4
+#define _BB_LZ4_LAST_LITERALS 5    // block must end in at least this many literals
+#define _BB_LZ4_MATCH_LIMIT 12     // last match must start at least this far before the end
+#define _BB_LZ4_HASH_BITS 12
+#define _BB_LZ4_MAX_OFFSET 65535
+#define _BB_LZ4_WILDCOPY 32         // spare bytes past the output the decoder may scribble on with fixed-size copies
+
+size_t bb_compress_bound(size_t length) {
+    return BB_VARINT_MAX + length + length / 255 + 16;
+}
+
+static uint32_t _bb_lz4_read32(const unsigned char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// hashes the 5 bytes at p (callers keep 8 readable) - one more byte than the minimum match spreads the 4096
+// slots over distinct continuations instead of piling up on common 4-byte prefixes
+static uint32_t _bb_lz4_hash(const unsigned char* p) {
+    uint64_t value = 0;
+    for (int i = 0; i < 5; i++) value |= (uint64_t) p[i] << (8 * i);
+    return (uint32_t) (((value << 24) * 889523592379ull) >> (64 - _BB_LZ4_HASH_BITS));
+}
+
+// how many of the 8 bytes at a and b agree, counting from the first
+static size_t _bb_lz4_common(const unsigned char* a, const unsigned char* b) {
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t x, y;
+    memcpy(&x, a, sizeof(x));
+    memcpy(&y, b, sizeof(y));
+    return x == y ? 8 : (size_t) __builtin_ctzll(x ^ y) >> 3;
+#else
+    size_t n = 0;
+    while (n < 8 && a[n] == b[n]) n++;
+    return n;
+#endif
+}
+
+static unsigned char* _bb_lz4_length(unsigned char* op, size_t length) {
+    for (; length >= 255; length -= 255) *op++ = 255;
+    *op++ = (unsigned char) length;
+    return op;
+}
+
+// op must have _BB_LZ4_WILDCOPY spare bytes past the bound, short literal runs are copied 16 bytes at a time
+static unsigned char* _bb_lz4_sequence(unsigned char* op, const unsigned char* literals, size_t literal_length, const unsigned char* in_end, size_t offset, size_t match_length) {
+    unsigned char* token = op++;
+    *token = (unsigned char) ((literal_length >= 15 ? 15 : literal_length) << 4);
+    if (literal_length >= 15) op = _bb_lz4_length(op, literal_length - 15);
+
+    if (literal_length <= 16 && in_end - literals >= 16) memcpy(op, literals, 16);
+    else memcpy(op, literals, literal_length);
+    op += literal_length;
+    if (match_length == 0) return op;   // final literals-only sequence
+
+    *op++ = (unsigned char) offset;
+    *op++ = (unsigned char) (offset >> 8);
+
+    match_length -= _BB_LZ4_MIN_MATCH;
+    *token |= (unsigned char) (match_length >= 15 ? 15 : match_length);
+    if (match_length >= 15) op = _bb_lz4_length(op, match_length - 15);
+
+    return op;
+}
+
+bool bb_compress(BinBuffer* dst, BinBuffer* src) {
+    if (!dst || !src || dst == src) return false;
+
+    size_t n = src->length;
+    if (!bb_reserve(dst, bb_compress_bound(n) + _BB_LZ4_WILDCOPY)) return false;
+
+    unsigned char* out = (unsigned char*) bb_store_uvarint(dst->data + dst->length, n);
+    unsigned char* op = out;
+    const unsigned char* in = (const unsigned char*) src->data;
+
+    size_t anchor = 0;
+    if (n > _BB_LZ4_MATCH_LIMIT) {
+        uint32_t table[1 << _BB_LZ4_HASH_BITS] = {0};
+        size_t ip = 1;
+        size_t last_start = n - _BB_LZ4_MATCH_LIMIT;
+        size_t match_end = n - _BB_LZ4_LAST_LITERALS;
+
+        while (ip <= last_start) {
+            uint32_t sequence = _bb_lz4_read32(in + ip);
+            uint32_t h = _bb_lz4_hash(in + ip);
+            size_t ref = table[h];
+            table[h] = (uint32_t) ip;
+
+            if (ref >= ip || ip - ref > _BB_LZ4_MAX_OFFSET || _bb_lz4_read32(in + ref) != sequence) {
+                // step faster through data that doesn't compress
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            while (ip > anchor && ref > 0 && in[ip - 1] == in[ref - 1]) {
+                ip--;
+                ref--;
+            }
+
+            size_t length = _BB_LZ4_MIN_MATCH, same = 8;
+            while (same == 8 && ip + length + 8 <= match_end) {
+                same = _bb_lz4_common(in + ref + length, in + ip + length);
+                length += same;
+            }
+            while (same == 8 && ip + length < match_end && in[ref + length] == in[ip + length]) length++;
+
+            op = _bb_lz4_sequence(op, in + anchor, ip - anchor, in + n, ip - ref, length);
+            ip += length;
+            anchor = ip;
+
+            // the match skipped over positions that were never hashed; index one near its end so a repeat
+            // right after it is found (the lookup at ip then tests for an immediate next match)
+            if (ip - 2 <= last_start) {
+                table[_bb_lz4_hash(in + ip - 2)] = (uint32_t) (ip - 2);
+            }
+        }
+    }
+
+    op = _bb_lz4_sequence(op, in + anchor, n - anchor, in + n, 0, 0);
+    dst->length = (char*) op - dst->data;
+
+    return true;
+}
+
+bool bb_decompress(BinBuffer* dst, BinBuffer* src) {
+    if (!dst || !src || dst == src) return false;
+
+    BinReader br = bb_reader(src);
+    uint64_t original = br_uvarint(&br);
+    if (!br_ok(&br)) return false;
+
+    // LZ4 can't expand more than ~255x, anything beyond is corrupt
+    size_t compressed = br_remaining(&br);
+    if (compressed == 0 || original / 255 > compressed || original > SIZE_MAX / 2) return false;
+
+    size_t old_length = dst->length;
+    if (!bb_reserve(dst, (size_t) original + _BB_LZ4_WILDCOPY)) return false;
+
+    const unsigned char* ip = (const unsigned char*) br_bytes(&br, compressed);
+    const unsigned char* in_end = ip + compressed;
+    unsigned char* out = (unsigned char*) dst->data + dst->length;
+    unsigned char* op = out;
+    unsigned char* out_end = out + original;
+
+    for (;;) {
+        if (ip >= in_end) goto malformed;
+        unsigned token = *ip++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length < 15 && in_end - ip >= 16) {
+            // short run: one fixed 16-byte copy, overshooting into bytes the rest of the sequence rewrites
+            if (literal_length > (size_t) (out_end - op)) goto malformed;
+            memcpy(op, ip, 16);
+        } else {
+            if (literal_length == 15) {
+                unsigned char b;
+                do {
+                    if (ip >= in_end) goto malformed;
+                    b = *ip++;
+                    literal_length += b;
+                } while (b == 255);
+            }
+            if (literal_length > (size_t) (in_end - ip) || literal_length > (size_t) (out_end - op)) goto malformed;
+            memcpy(op, ip, literal_length);
+        }
+        ip += literal_length;
+        op += literal_length;
+        if (ip == in_end) break;
+
+        if (in_end - ip < 2) goto malformed;
+        size_t offset = ip[0] | (size_t) ip[1] << 8;
+        ip += 2;
+        if (offset == 0 || offset > (size_t) (op - out)) goto malformed;
+
+        const unsigned char* match = op - offset;
+        size_t match_length = token & 15;
+        if (match_length < 15 && offset >= 8) {
+            // at most 18 bytes from at least 8 back: three fixed copies, no loop
+            match_length += _BB_LZ4_MIN_MATCH;
+            if (match_length > (size_t) (out_end - op)) goto malformed;
+            memcpy(op, match, 8);
+            memcpy(op + 8, match + 8, 8);
+            memcpy(op + 16, match + 16, 2);
+            op += match_length;
+            continue;
+        }
+        if (match_length == 15) {
+            unsigned char b;
+            do {
+                if (ip >= in_end) goto malformed;
+                b = *ip++;
+                match_length += b;
+            } while (b == 255);
+        }
+        match_length += _BB_LZ4_MIN_MATCH;
+        if (match_length > (size_t) (out_end - op)) goto malformed;
+
+        // 8 bytes at a time, up to 7 past the end of the match; a source closer than 8 bytes is first spread out
+        // so that it ends up at least 8 behind the destination, after which plain 8-byte copies replicate it
+        static const unsigned spread_forward[8] = {0, 1, 2, 1, 0, 4, 4, 4};
+        static const int spread_back[8] = {0, 0, 0, -1, -4, 1, 2, 3};
+        unsigned char* match_end = op + match_length;
+        if (offset < 8) {
+            op[0] = match[0];
+            op[1] = match[1];
+            op[2] = match[2];
+            op[3] = match[3];
+            match += spread_forward[offset];
+            memcpy(op + 4, match, 4);
+            match -= spread_back[offset];
+        } else {
+            memcpy(op, match, 8);
+            match += 8;
+        }
+        op += 8;
+        while (op < match_end) {
+            memcpy(op, match, 8);
+            op += 8;
+            match += 8;
+        }
+        op = match_end;
+    }
+
+    if (op != out_end) goto malformed;
+    dst->length += original;
+
+    return true;
+
+malformed:
+    bb_truncate(dst, old_length);
+    return false;
+}
+
+GapBinBuffer* gbb_create(size_t capacity) {
+    GapBinBuffer* gbb = (GapBinBuffer*) malloc (sizeof(GapBinBuffer));
+    if (!gbb) return NULL;
+
+    if (capacity < 16) capacity = 16;
+    gbb->data = (char*) malloc (capacity);
+    if (!gbb->data) {
+        free(gbb);
+        return NULL;
+    }
+
+    gbb->capacity = capacity;
+    gbb->gap_start = 0;
+    gbb->gap_end = capacity;
+
+    return gbb;
+}
+
+bool gbb_destroy(GapBinBuffer* gbb) {
+    if (!gbb) return false;
+    free(gbb->data);
+    free(gbb);
+    return true;
+}
+
+size_t gbb_length(GapBinBuffer* gbb) {
+    if (!gbb) return 0;
+    return gbb->capacity - (gbb->gap_end - gbb->gap_start);
+}
+
+static void _gbb_move_gap(GapBinBuffer* gbb, size_t index) {
+    if (index < gbb->gap_start) {
+        size_t n = gbb->gap_start - index;
+        memmove(gbb->data + gbb->gap_end - n, gbb->data + index, n);
+        gbb->gap_start -= n;
+        gbb->gap_end -= n;
+    } else if (index > gbb->gap_start) {
+        size_t n = index - gbb->gap_start;
+        memmove(gbb->data + gbb->gap_start, gbb->data + gbb->gap_end, n);
+        gbb->gap_start += n;
+        gbb->gap_end += n;
+    }
+}
+
+static bool _gbb_grow(GapBinBuffer* gbb, size_t additional) {
+    size_t length = gbb_length(gbb);
+    if (additional > SIZE_MAX / 2 - length) return false;
+
+    size_t capacity = 2 * gbb->capacity;
+    if (capacity < length + additional) capacity = 2 * (length + additional);
+
+    char* data = (char*) malloc (capacity);
+    if (!data) return false;
+
+    size_t tail = gbb->capacity - gbb->gap_end;
+    memcpy(data, gbb->data, gbb->gap_start);
+    memcpy(data + capacity - tail, gbb->data + gbb->gap_end, tail);
+    free(gbb->data);
+
+    gbb->data = data;
+    gbb->gap_end = capacity - tail;
+    gbb->capacity = capacity;
+
+    return true;
+}
+
+bool gbb_insert(GapBinBuffer* gbb, size_t index, const char* data, size_t length) {
+    if (!gbb || !data || length == 0 || index > gbb_length(gbb)) return false;
+    if (length > gbb->gap_end - gbb->gap_start && !_gbb_grow(gbb, length)) return false;
+
+    _gbb_move_gap(gbb, index);
+    memcpy(gbb->data + gbb->gap_start, data, length);
+    gbb->gap_start += length;
+
+    return true;
+}
+
+bool gbb_erase(GapBinBuffer* gbb, size_t index, size_t length) {
+    if (!gbb || index > gbb_length(gbb) || length > gbb_length(gbb) - index) return false;
+
+    _gbb_move_gap(gbb, index);
+    gbb->gap_end += length;
+
+    return true;
+}
+
+char gbb_get_byte(GapBinBuffer* gbb, size_t index) {
+    if (!gbb || index >= gbb_length(gbb)) return 0;
+    if (index < gbb->gap_start) return gbb->data[index];
+    return gbb->data[index + (gbb->gap_end - gbb->gap_start)];
+}
+
+BinBuffer* gbb_collect(GapBinBuffer* gbb) {
+    if (!gbb) return NULL;
+
+    size_t length = gbb_length(gbb);
+    _gbb_move_gap(gbb, length);
+
+    BinBuffer* bb = bb_adopt(gbb->data, length, gbb->capacity);
+    if (!bb) return NULL;
+    free(gbb);
+
+    return bb;
+}
+
+// raw search helpers return an offset relative to data, or length when not found
+static size_t _bb_find_any_scalar(const char* data, size_t length, const char* set, size_t set_length) {
+    bool table[256] = {0};
+    for (size_t j = 0; j < set_length; j++) table[(unsigned char) set[j]] = true;
+
+    for (size_t i = 0; i < length; i++) {
+        if (table[(unsigned char) data[i]]) return i;
+    }
+
+    return length;
+}
+
+static size_t _bb_find_substr_scalar(const char* data, size_t length, const char* needle, size_t needle_length) {
+    if (needle_length > length) return length;
+
+    size_t last = length - needle_length;
+    for (size_t i = 0; i <= last; i++) {
+        const char* hit = (const char*) memchr (data + i, needle[0], last - i + 1);
+        if (!hit) break;
+        i = hit - data;
+        if (memcmp(hit + 1, needle + 1, needle_length - 1) == 0) return i;
+    }
+
+    return length;
+}
+
+#ifdef BB_X86
+static bool _bb_has_avx2(void) {
+    // relaxed atomics: threads may race to fill it in, but only ever with the same answer
+    static int cached = -1;
+    int supported = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+    if (supported < 0) {
+        __builtin_cpu_init();
+        supported = __builtin_cpu_supports("avx2") ? 1 : 0;
+        __atomic_store_n(&cached, supported, __ATOMIC_RELAXED);
+    }
+    return supported;
+}
+
+static size_t _bb_find_any_sse2(const char* data, size_t length, const char* set, size_t set_length) {
+    __m128i needles[16];
+    for (size_t j = 0; j < set_length; j++) needles[j] = _mm_set1_epi8(set[j]);
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*) (data + i));
+        __m128i hit = _mm_setzero_si128();
+        for (size_t j = 0; j < set_length; j++) hit = _mm_or_si128(hit, _mm_cmpeq_epi8(block, needles[j]));
+
+        unsigned mask = (unsigned) _mm_movemask_epi8(hit);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+
+    return i + _bb_find_any_scalar(data + i, length - i, set, set_length);
+}
+
+__attribute__((target("avx2")))
+static size_t _bb_find_any_avx2(const char* data, size_t length, const char* set, size_t set_length) {
+    __m256i needles[16];
+    for (size_t j = 0; j < set_length; j++) needles[j] = _mm256_set1_epi8(set[j]);
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*) (data + i));
+        __m256i hit = _mm256_setzero_si256();
+        for (size_t j = 0; j < set_length; j++) hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(block, needles[j]));
+
+        unsigned mask = (unsigned) _mm256_movemask_epi8(hit);
+        if (mask) return i + __builtin_ctz(mask);
+    }
+
+    return i + _bb_find_any_scalar(data + i, length - i, set, set_length);
+}
+
+// compares first and last needle byte over a whole block, memcmp only on candidates
+static size_t _bb_find_substr_sse2(const char* data, size_t length, const char* needle, size_t needle_length) {
+    __m128i first = _mm_set1_epi8(needle[0]);
+    __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+
+    size_t i = 0;
+    for (; needle_length - 1 + i + 16 <= length; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i*) (data + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i*) (data + i + needle_length - 1));
+        unsigned mask = (unsigned) _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+
+        while (mask) {
+            size_t at = i + __builtin_ctz(mask);
+            if (memcmp(data + at + 1, needle + 1, needle_length - 2) == 0) return at;
+            mask &= mask - 1;
+        }
+    }
+
+    return i + _bb_find_substr_scalar(data + i, length - i, needle, needle_length);
+}
+
+__attribute__((target("avx2")))
+static size_t _bb_find_substr_avx2(const char* data, size_t length, const char* needle, size_t needle_length) {
+    __m256i first = _mm256_set1_epi8(needle[0]);
+    __m256i last = _mm256_set1_epi8(needle[needle_length - 1]);
+
+    size_t i = 0;
+    for (; needle_length - 1 + i + 32 <= length; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i*) (data + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i*) (data + i + needle_length - 1));
+        unsigned mask = (unsigned) _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last)));
+
+        while (mask) {
+            size_t at = i + __builtin_ctz(mask);
+            if (memcmp(data + at + 1, needle + 1, needle_length - 2) == 0) return at;
+            mask &= mask - 1;
+        }
+    }
+
+    return i + _bb_find_substr_scalar(data + i, length - i, needle, needle_length);
+}
+#endif
+
+size_t bb_find_byte(BinBuffer* bb, size_t start, char byte) {
+    if (!bb) return 0;
+    if (start >= bb->length) return bb->length;
+
+    // libc memchr already dispatches to the widest vector unit available
+    const char* hit = (const char*) memchr (bb->data + start, byte, bb->length - start);
+    return hit ? (size_t) (hit - bb->data) : bb->length;
+}
+
+size_t bb_find_any(BinBuffer* bb, size_t start, const char* set, size_t set_length) {
+    if (!bb) return 0;
+    if (start >= bb->length || !set || set_length == 0) return bb->length;
+    if (set_length == 1) return bb_find_byte(bb, start, set[0]);
+
+    const char* data = bb->data + start;
+    size_t length = bb->length - start;
+#ifdef BB_X86
+    if (set_length <= 16) {
+        if (_bb_has_avx2()) return start + _bb_find_any_avx2(data, length, set, set_length);
+        return start + _bb_find_any_sse2(data, length, set, set_length);
+    }
+#endif
+    return start + _bb_find_any_scalar(data, length, set, set_length);
+}
+
+size_t bb_find_substr(BinBuffer* bb, size_t start, const char* needle, size_t needle_length) {
+    if (!bb) return 0;
+    if (start > bb->length || !needle) return bb->length;
+    if (needle_length == 0) return start;
+    if (needle_length == 1) return bb_find_byte(bb, start, needle[0]);
+
+    const char* data = bb->data + start;
+    size_t length = bb->length - start;
+    if (needle_length > length) return bb->length;
+#ifdef BB_X86
+    if (_bb_has_avx2()) return start + _bb_find_substr_avx2(data, length, needle, needle_length);
+    return start + _bb_find_substr_sse2(data, length, needle, needle_length);
+#else
+    return start + _bb_find_substr_scalar(data, length, needle, needle_length);
+#endif
+}
+
+bool bb_next_record(BinBuffer* bb, size_t* pos, char delim, BinBufferView* record) {
+    if (!bb || !pos || !record || *pos >= bb->length) return false;
+
+    size_t end = bb_find_byte(bb, *pos, delim);
+    *record = bb_view(bb, *pos, end - *pos);
+    *pos = end < bb->length ? end + 1 : end;
+
+    return true;
+}
+
+#ifdef BB_POSIX
+// consumes iov in place while writing
+static bool _bb_writev_all(int fd, struct iovec* iov, size_t iovcnt) {
+    while (iovcnt > 0) {
+        if (iov->iov_len == 0) {
+            iov++;
+            iovcnt--;
+            continue;
+        }
+
+        ssize_t written = writev(fd, iov, iovcnt > IOV_MAX ? IOV_MAX : (int) iovcnt);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        size_t left = (size_t) written;
+        while (iovcnt > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (left > 0) {
+            iov->iov_base = (char*) iov->iov_base + left;
+            iov->iov_len -= left;
+        }
+    }
+
+    return true;
+}
+
+bool bb_write_fd(BinBuffer* bb, int fd) {
+    if (!bb) return false;
+
+    struct iovec iov = { bb->data, bb->length };
+    return _bb_writev_all(fd, &iov, 1);
+}
+
+bool bb_writev_fd(BinBuffer** bbs, size_t count, int fd) {
+    if (!bbs) return false;
+
+    struct iovec iov[64];
+    while (count > 0) {
+        size_t n = count < 64 ? count : 64;
+        for (size_t i = 0; i < n; i++) {
+            if (!bbs[i]) return false;
+            iov[i].iov_base = bbs[i]->data;
+            iov[i].iov_len = bbs[i]->length;
+        }
+
+        if (!_bb_writev_all(fd, iov, n)) return false;
+        bbs += n;
+        count -= n;
+    }
+
+    return true;
+}
+
+bool cbb_write_fd(ChunkedBinBuffer* cbb, int fd) {
+    if (!cbb) return false;
+
+    struct iovec iov[64];
+    for (size_t first = 0; first < cbb->chunk_count; first += 64) {
+        size_t n = 0;
+        for (; n < 64 && first + n < cbb->chunk_count; n++) {
+            const char* data;
+            iov[n].iov_len = cbb_chunk(cbb, first + n, &data);
+            iov[n].iov_base = (void*) data;
+        }
+
+        if (!_bb_writev_all(fd, iov, n)) return false;
+    }
+
+    return true;
+}
+
+// grows before reading rather than spilling past capacity, so a failed reservation never swallows input
+ssize_t bb_read_fd(BinBuffer* bb, int fd, size_t length) {
+    if (!bb) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (bb->storage == BB_STORAGE_MAP_READONLY) {
+        errno = EBADF;
+        return -1;
+    }
+
+    size_t want = length < BB_READ_CHUNK ? length : BB_READ_CHUNK;
+    if (bb->capacity - bb->length < want && !bb_reserve(bb, want)) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    size_t spare = bb->capacity - bb->length;
+    if (spare > length) spare = length;
+
+    ssize_t got;
+    do {
+        got = read(fd, bb->data + bb->length, spare);
+    } while (got < 0 && errno == EINTR);
+    if (got <= 0) return got;
+
+    bb->length += got;
+    return got;
+}
+
+BinBuffer* bb_map_file(const char* path, BinBufferStorage storage, BinBufferAdvice advice) {
+    // only the file-backed kinds; anything else would record a storage the mapping doesn't have
+    if (!path) return NULL;
+    if (storage != BB_STORAGE_MAP_READONLY && storage != BB_STORAGE_MAP_PRIVATE && storage != BB_STORAGE_MAP_SHARED) return NULL;
+
+    BinBuffer* bb = (BinBuffer*) malloc (sizeof(BinBuffer));
+    if (!bb) return NULL;
+
+    int fd = storage == BB_STORAGE_MAP_SHARED ? open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644) : open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) goto fail;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) goto fail_fd;
+
+    bb->data = NULL;
+    bb->length = (size_t) st.st_size;
+    bb->capacity = (size_t) st.st_size;
+    bb->storage = storage;
+    bb->fd = -1;
+    bb->crc32c = 0;
+    bb->crc32c_length = 0;
+    bb->crc32c_tracking = false;
+#ifdef DEBUG
+    bb->generation = 0;
+#endif
+
+    int prot = PROT_READ, flags = MAP_PRIVATE;
+    if (storage == BB_STORAGE_MAP_PRIVATE) {
+        prot |= PROT_WRITE;
+    } else if (storage == BB_STORAGE_MAP_SHARED) {
+        // leave room to append; the file is cut back to length on destroy
+        size_t page = (size_t) sysconf(_SC_PAGESIZE);
+        bb->capacity = (bb->length / page + 1) * page;
+        if (ftruncate(fd, bb->capacity) < 0) goto fail_fd;
+        prot |= PROT_WRITE;
+        flags = MAP_SHARED;
+    }
+
+    if (bb->capacity > 0) {
+        char* data = (char*) mmap (NULL, bb->capacity, prot, flags, fd, 0);
+        if (data == MAP_FAILED) goto fail_fd;
+        bb->data = data;
+
+        int hint = advice == BB_ADVISE_SEQUENTIAL ? POSIX_MADV_SEQUENTIAL : advice == BB_ADVISE_RANDOM ? POSIX_MADV_RANDOM : POSIX_MADV_NORMAL;
+        posix_madvise(data, bb->capacity, hint);
+    }
+
+    if (storage == BB_STORAGE_MAP_SHARED) bb->fd = fd;
+    else close(fd);
+
+    return bb;
+
+fail_fd:
+    close(fd);
+fail:
+    free(bb);
+    return NULL;
+}
+#endif
+
+#ifdef BB_LINUX
+BinBuffer* bb_create_large(size_t capacity, bool huge_pages) {
+    // huge pages only kick in for 2 MiB aligned extents
+    size_t align = huge_pages ? (size_t) 2 << 20 : (size_t) sysconf(_SC_PAGESIZE);
+    if (capacity == 0 || capacity > SIZE_MAX - align) return NULL;
+    capacity = (capacity + align - 1) / align * align;
+
+    BinBuffer* bb = (BinBuffer*) malloc (sizeof(BinBuffer));
+    if (!bb) return NULL;
+
+    char* data = (char*) mmap (NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        free(bb);
+        return NULL;
+    }
+    if (huge_pages) madvise(data, capacity, MADV_HUGEPAGE);
+
+    bb->data = data;
+    bb->length = 0;
+    bb->capacity = capacity;
+    bb->storage = huge_pages ? BB_STORAGE_MAP_HUGE : BB_STORAGE_MAP_ANON;
+    bb->fd = -1;
+    bb->crc32c = 0;
+    bb->crc32c_length = 0;
+    bb->crc32c_tracking = false;
+#ifdef DEBUG
+    bb->generation = 0;
+#endif
+
+    return bb;
+}
+
+BinRing* bbr_create(size_t capacity) {
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    if (capacity == 0 || capacity > SIZE_MAX / 2 - page) return NULL;
+    capacity = (capacity + page - 1) / page * page;
+
+    BinRing* ring = (BinRing*) malloc (sizeof(BinRing));
+    if (!ring) return NULL;
+
+    int fd = memfd_create("bb_ring", MFD_CLOEXEC);
+    if (fd < 0 || ftruncate(fd, capacity) < 0) goto fail_fd;
+
+    // reserve address space for both halves first, then map the file over each half
+    char* base = (char*) mmap (NULL, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) goto fail_fd;
+
+    if (mmap(base, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, 2 * capacity);
+        goto fail_fd;
+    }
+    close(fd);
+
+    ring->data = base;
+    ring->capacity = capacity;
+    ring->head = 0;
+    ring->length = 0;
+
+    return ring;
+
+fail_fd:
+    if (fd >= 0) close(fd);
+    free(ring);
+    return NULL;
+}
+
+bool bbr_destroy(BinRing* ring) {
+    if (!ring) return false;
+    munmap(ring->data, 2 * ring->capacity);
+    free(ring);
+    return true;
+}
+
+char* bbr_write_span(BinRing* ring, size_t* available) {
+    if (!ring) return NULL;
+    if (available) *available = ring->capacity - ring->length;
+    return ring->data + (ring->head + ring->length) % ring->capacity;
+}
+
+bool bbr_produce(BinRing* ring, size_t length) {
+    if (!ring || length > ring->capacity - ring->length) return false;
+    ring->length += length;
+    return true;
+}
+
+const char* bbr_read_span(BinRing* ring, size_t* available) {
+    if (!ring) return NULL;
+    if (available) *available = ring->length;
+    return ring->data + ring->head;
+}
+
+bool bbr_consume(BinRing* ring, size_t length) {
+    if (!ring || length > ring->length) return false;
+    ring->head = (ring->head + length) % ring->capacity;
+    ring->length -= length;
+    return true;
+}
+
+bool bbr_write(BinRing* ring, const char* data, size_t length) {
+    size_t available;
+    char* dst = bbr_write_span(ring, &available);
+    if (!dst || !data || length > available) return false;
+
+    memcpy(dst, data, length);
+    ring->length += length;
+
+    return true;
+}
+
+// drops `length` transferred bytes off the front of the request's iovecs
+static void _bbio_advance(_BBIORequest* req, size_t length) {
+    req->done += length;
+    req->remaining -= length;
+    while (req->iov_count > 0 && length >= req->iov->iov_len) {
+        length -= req->iov->iov_len;
+        req->iov++;
+        req->iov_count--;
+    }
+    if (length > 0) {
+        req->iov->iov_base = (char*) req->iov->iov_base + length;
+        req->iov->iov_len -= length;
+    }
+}
+
+static void _bbio_run_blocking(_BBIORequest* req) {
+    while (req->remaining > 0) {
+        int count = req->iov_count > IOV_MAX ? IOV_MAX : (int) req->iov_count;
+        off_t offset = (off_t) (req->offset + req->done);
+        ssize_t n = req->read ? preadv(req->fd, req->iov, count, offset) : pwritev(req->fd, req->iov, count, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            req->result = -errno;
+            return;
+        }
+        if (n == 0) break;  // end of file
+        _bbio_advance(req, (size_t) n);
+    }
+    req->result = (int64_t) req->done;
+}
+
+static void* _bbio_worker(void* arg) {
+    BinBufferIO* io = (BinBufferIO*) arg;
+
+    pthread_mutex_lock(&io->lock);
+    for (;;) {
+        while (io->queue_count == 0 && !io->stopping) pthread_cond_wait(&io->work_ready, &io->lock);
+        if (io->queue_count == 0) break;
+
+        unsigned slot = io->queue[io->queue_head];
+        io->queue_head = (io->queue_head + 1) % io->depth;
+        io->queue_count--;
+
+        pthread_mutex_unlock(&io->lock);
+        _bbio_run_blocking(&io->requests[slot]);
+        pthread_mutex_lock(&io->lock);
+
+        io->completed[(io->completed_head + io->completed_count) % io->depth] = slot;
+        io->completed_count++;
+        pthread_cond_signal(&io->work_done);
+    }
+    pthread_mutex_unlock(&io->lock);
+
+    return NULL;
+}
+
+#ifdef BB_IO_URING
+static bool _bbio_uring_setup(BinBufferIO* io) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int fd = (int) syscall(__NR_io_uring_setup, io->depth, &params);
+    if (fd < 0) return false;
+
+    io->ring_fd = fd;
+    io->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    io->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (io->cq_ring_size > io->sq_ring_size) io->sq_ring_size = io->cq_ring_size;
+        io->cq_ring_size = io->sq_ring_size;
+    }
+
+    io->sq_ring = mmap(NULL, io->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (io->sq_ring == MAP_FAILED) goto fail;
+
+    io->cq_ring = io->sq_ring;
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        io->cq_ring = mmap(NULL, io->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (io->cq_ring == MAP_FAILED) goto fail_sq;
+    }
+
+    io->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    io->sqes = mmap(NULL, io->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (io->sqes == MAP_FAILED) goto fail_cq;
+
+    io->sq_tail = (unsigned*) ((char*) io->sq_ring + params.sq_off.tail);
+    io->sq_mask = (unsigned*) ((char*) io->sq_ring + params.sq_off.ring_mask);
+    io->sq_array = (unsigned*) ((char*) io->sq_ring + params.sq_off.array);
+    io->cq_head = (unsigned*) ((char*) io->cq_ring + params.cq_off.head);
+    io->cq_tail = (unsigned*) ((char*) io->cq_ring + params.cq_off.tail);
+    io->cq_mask = (unsigned*) ((char*) io->cq_ring + params.cq_off.ring_mask);
+    io->cqes = (char*) io->cq_ring + params.cq_off.cqes;
+    io->to_submit = 0;
+    io->uring = true;
+
+    return true;
+
+fail_cq:
+    if (io->cq_ring != io->sq_ring) munmap(io->cq_ring, io->cq_ring_size);
+fail_sq:
+    munmap(io->sq_ring, io->sq_ring_size);
+fail:
+    close(fd);
+    return false;
+}
+
+static void _bbio_uring_queue(BinBufferIO* io, unsigned slot) {
+    _BBIORequest* req = &io->requests[slot];
+    unsigned tail = *io->sq_tail;
+    unsigned index = tail & *io->sq_mask;
+
+    struct io_uring_sqe* sqe = &((struct io_uring_sqe*) io->sqes)[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = req->read ? IORING_OP_READV : IORING_OP_WRITEV;
+    sqe->fd = req->fd;
+    sqe->addr = (uint64_t) (uintptr_t) req->iov;
+    sqe->len = req->iov_count > IOV_MAX ? IOV_MAX : (unsigned) req->iov_count;
+    sqe->off = req->offset + req->done;
+    sqe->user_data = slot;
+
+    io->sq_array[index] = index;
+    __atomic_store_n(io->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    io->to_submit++;
+}
+#endif
+
+static void _bbio_finish(BinBufferIO* io, unsigned slot, BinBufferIOCompletion* completion) {
+    _BBIORequest* req = &io->requests[slot];
+    if (req->read && req->result > 0) req->bb->length += (size_t) req->result;
+
+    completion->user_data = req->user_data;
+    completion->result = req->result;
+
+    free(req->iov_owned);
+    req->iov_owned = NULL;
+    req->bb = NULL;
+    io->free_slots[io->free_count++] = slot;
+}
+
+BinBufferIO* bbio_create(unsigned depth, bool allow_io_uring) {
+    if (depth == 0) return NULL;
+
+    BinBufferIO* io = (BinBufferIO*) calloc (1, sizeof(BinBufferIO));
+    if (!io) return NULL;
+
+    io->depth = depth;
+    io->ring_fd = -1;
+    io->requests = (_BBIORequest*) calloc (depth, sizeof(_BBIORequest));
+    io->free_slots = (unsigned*) malloc (depth * sizeof(unsigned));
+    io->staged = (unsigned*) malloc (depth * sizeof(unsigned));
+    io->queue = (unsigned*) malloc (depth * sizeof(unsigned));
+    io->completed = (unsigned*) malloc (depth * sizeof(unsigned));
+    if (!io->requests || !io->free_slots || !io->staged || !io->queue || !io->completed) goto fail;
+
+    for (unsigned i = 0; i < depth; i++) io->free_slots[i] = depth - 1 - i;
+    io->free_count = depth;
+
+#ifdef BB_IO_URING
+    if (allow_io_uring && _bbio_uring_setup(io)) return io;
+#else
+    (void) allow_io_uring;
+#endif
+
+    pthread_mutex_init(&io->lock, NULL);
+    pthread_cond_init(&io->work_ready, NULL);
+    pthread_cond_init(&io->work_done, NULL);
+    unsigned threads = depth < BB_IO_THREADS ? depth : BB_IO_THREADS;
+    for (; io->worker_count < threads; io->worker_count++) {
+        if (pthread_create(&io->workers[io->worker_count], NULL, _bbio_worker, io) != 0) break;
+    }
+    if (io->worker_count == 0) {
+        pthread_mutex_destroy(&io->lock);
+        pthread_cond_destroy(&io->work_ready);
+        pthread_cond_destroy(&io->work_done);
+        goto fail;
+    }
+
+    return io;
+
+fail:
+    free(io->requests);
+    free(io->free_slots);
+    free(io->staged);
+    free(io->queue);
+    free(io->completed);
+    free(io);
+    return NULL;
+}
+
+bool bbio_destroy(BinBufferIO* io) {
+    if (!io) return false;
+
+    BinBufferIOCompletion completions[16];
+    while (bbio_in_flight(io) > 0) bbio_poll(io, completions, 16, true);
+
+#ifdef BB_IO_URING
+    if (io->uring) {
+        munmap(io->sqes, io->sqes_size);
+        if (io->cq_ring != io->sq_ring) munmap(io->cq_ring, io->cq_ring_size);
+        munmap(io->sq_ring, io->sq_ring_size);
+        close(io->ring_fd);
+    }
+#endif
+    if (!io->uring) {
+        pthread_mutex_lock(&io->lock);
+        io->stopping = true;
+        pthread_cond_broadcast(&io->work_ready);
+        pthread_mutex_unlock(&io->lock);
+        for (unsigned i = 0; i < io->worker_count; i++) pthread_join(io->workers[i], NULL);
+
+        pthread_mutex_destroy(&io->lock);
+        pthread_cond_destroy(&io->work_ready);
+        pthread_cond_destroy(&io->work_done);
+    }
+
+    free(io->requests);
+    free(io->free_slots);
+    free(io->staged);
+    free(io->queue);
+    free(io->completed);
+    free(io);
+
+    return true;
+}
+
+size_t bbio_in_flight(BinBufferIO* io) {
+    return io ? io->depth - io->free_count : 0;
+}
+
+// errors meaning "not for this pair of fds", worth retrying with the next method
+static bool _bb_transfer_refused(int error) {
+    return error == EINVAL || error == ENOSYS || error == EXDEV || error == EOPNOTSUPP || error == EBADF || error == ESPIPE;
+}
+
+ssize_t bb_transfer_fd(int out_fd, int in_fd, size_t length) {
+    enum { COPY_FILE_RANGE, SENDFILE, SPLICE, BUFFER } method = COPY_FILE_RANGE;
+    int pipe_fds[2] = { -1, -1 };
+    BinBuffer* bb = NULL;
+    size_t done = 0;
+    bool failed = false;
+
+    while (done < length) {
+        size_t want = length - done;
+        if (want > (size_t) 1 << 30) want = (size_t) 1 << 30;
+
+        ssize_t n;
+        if (method == COPY_FILE_RANGE) {
+            n = copy_file_range(in_fd, NULL, out_fd, NULL, want, 0);
+        } else if (method == SENDFILE) {
+            n = sendfile(out_fd, in_fd, NULL, want);
+        } else if (method == SPLICE) {
+            if (pipe_fds[0] < 0 && pipe2(pipe_fds, O_CLOEXEC) < 0) {
+                method = BUFFER;
+                continue;
+            }
+
+            n = splice(in_fd, NULL, pipe_fds[1], NULL, want, SPLICE_F_MOVE | SPLICE_F_MORE);
+            size_t left = n > 0 ? (size_t) n : 0;
+            while (left > 0) {
+                ssize_t out = splice(pipe_fds[0], NULL, out_fd, NULL, left, SPLICE_F_MOVE | SPLICE_F_MORE);
+                if (out < 0 && errno == EINTR) continue;
+                if (out <= 0) break;
+                left -= (size_t) out;
+            }
+
+            if (left > 0) {
+                // output side won't splice - push out what's stuck in the pipe and stop splicing
+                if (!bb && !(bb = bb_create(65536))) {
+                    failed = true;
+                    break;
+                }
+                bb_clear(bb);
+                while (bb->length < left) {
+                    if (bb_read_fd(bb, pipe_fds[0], left - bb->length) <= 0) break;
+                }
+                if (bb->length < left || !bb_write_fd(bb, out_fd)) {
+                    failed = true;
+                    break;
+                }
+                method = BUFFER;
+            }
+        } else {
+            if (!bb && !(bb = bb_create(65536))) {
+                failed = true;
+                break;
+            }
+            bb_clear(bb);
+            n = bb_read_fd(bb, in_fd, want < bb->capacity ? want : bb->capacity);
+            if (n > 0 && !bb_write_fd(bb, out_fd)) {
+                failed = true;
+                break;
+            }
+        }
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (method != BUFFER && _bb_transfer_refused(errno)) {
+                method++;
+                continue;
+            }
+            failed = true;
+            break;
+        }
+        if (n == 0) break;  // end of input
+
+        done += (size_t) n;
+    }
+
+    int saved_errno = errno;
+    if (pipe_fds[0] >= 0) {
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+    }
+    bb_destroy(bb);
+    errno = saved_errno;
+
+    if (failed && done == 0) return -1;
+    return (ssize_t) done;
+}
+
+// takes a free slot and fills in everything but the iovecs
+static _BBIORequest* _bbio_prepare(BinBufferIO* io, int fd, bool read, uint64_t offset, uint64_t user_data, unsigned* slot) {
+    if (!io || fd < 0 || io->free_count == 0) return NULL;
+
+    *slot = io->free_slots[io->free_count - 1];
+    _BBIORequest* req = &io->requests[*slot];
+    memset(req, 0, sizeof(*req));
+    req->fd = fd;
+    req->read = read;
+    req->offset = offset;
+    req->user_data = user_data;
+
+    return req;
+}
+
+static void _bbio_queue(BinBufferIO* io, unsigned slot) {
+    io->free_count--;
+#ifdef BB_IO_URING
+    if (io->uring) {
+        _bbio_uring_queue(io, slot);
+        return;
+    }
+#endif
+    io->staged[io->staged_count++] = slot;
+}
+
+bool bbio_write(BinBufferIO* io, int fd, BinBuffer* bb, uint64_t offset, uint64_t user_data) {
+    unsigned slot;
+    _BBIORequest* req = _bbio_prepare(io, fd, false, offset, user_data, &slot);
+    if (!req || !bb) return false;
+
+    req->bb = bb;
+    req->single.iov_base = bb->data;
+    req->single.iov_len = bb->length;
+    req->iov = &req->single;
+    req->iov_count = 1;
+    req->remaining = bb->length;
+    _bbio_queue(io, slot);
+
+    return true;
+}
+
+bool bbio_write_chunked(BinBufferIO* io, int fd, ChunkedBinBuffer* cbb, uint64_t offset, uint64_t user_data) {
+    unsigned slot;
+    _BBIORequest* req = _bbio_prepare(io, fd, false, offset, user_data, &slot);
+    if (!req || !cbb) return false;
+
+    size_t count = cbb->chunk_count ? cbb->chunk_count : 1;
+    req->iov_owned = (struct iovec*) calloc (count, sizeof(struct iovec));
+    if (!req->iov_owned) return false;
+
+    req->iov = req->iov_owned;
+    req->iov_count = cbb_iovecs(cbb, req->iov_owned, count);
+    req->remaining = cbb->length;
+    _bbio_queue(io, slot);
+
+    return true;
+}
+
+static bool _bbio_busy(BinBufferIO* io, BinBuffer* bb) {
+    for (unsigned i = 0; i < io->depth; i++) {
+        if (io->requests[i].bb == bb) return true;
+    }
+    return false;
+}
+
+bool bbio_read(BinBufferIO* io, int fd, BinBuffer* bb, size_t length, uint64_t offset, uint64_t user_data) {
+    if (io && bb && _bbio_busy(io, bb)) {
+        errno = EBUSY;
+        return false;
+    }
+
+    unsigned slot;
+    _BBIORequest* req = _bbio_prepare(io, fd, true, offset, user_data, &slot);
+    if (!req || !bb || !bb_reserve(bb, length)) return false;
+
+    req->bb = bb;
+    req->single.iov_base = bb->data + bb->length;
+    req->single.iov_len = length;
+    req->iov = &req->single;
+    req->iov_count = 1;
+    req->remaining = length;
+    _bbio_queue(io, slot);
+
+    return true;
+}
+
+int bbio_submit(BinBufferIO* io) {
+    if (!io) return -1;
+
+#ifdef BB_IO_URING
+    if (io->uring) {
+        if (io->to_submit == 0) return 0;
+        int submitted = (int) syscall(__NR_io_uring_enter, io->ring_fd, io->to_submit, 0, 0, NULL, 0);
+        if (submitted < 0) return -1;
+        io->to_submit -= (unsigned) submitted;
+        return submitted;
+    }
+#endif
+
+    pthread_mutex_lock(&io->lock);
+    int submitted = (int) io->staged_count;
+    for (unsigned i = 0; i < io->staged_count; i++) {
+        io->queue[(io->queue_head + io->queue_count) % io->depth] = io->staged[i];
+        io->queue_count++;
+    }
+    io->staged_count = 0;
+    if (submitted > 0) pthread_cond_broadcast(&io->work_ready);
+    pthread_mutex_unlock(&io->lock);
+
+    return submitted;
+}
+
+size_t bbio_poll(BinBufferIO* io, BinBufferIOCompletion* completions, size_t max, bool wait) {
+    if (!io || !completions || max == 0) return 0;
+    size_t count = 0;
+
+#ifdef BB_IO_URING
+    if (io->uring) {
+        for (;;) {
+            if (io->to_submit > 0) bbio_submit(io);
+
+            unsigned head = *io->cq_head;
+            unsigned tail = __atomic_load_n(io->cq_tail, __ATOMIC_ACQUIRE);
+            while (head != tail && count < max) {
+                struct io_uring_cqe* cqe = &((struct io_uring_cqe*) io->cqes)[head & *io->cq_mask];
+                unsigned slot = (unsigned) cqe->user_data;
+                int res = cqe->res;
+                head++;
+
+                _BBIORequest* req = &io->requests[slot];
+                if (res == -EINTR || res == -EAGAIN) {
+                    _bbio_uring_queue(io, slot);
+                    continue;
+                }
+                if (res > 0) {
+                    // short transfer or more iovecs than one submission takes - carry on where it stopped
+                    _bbio_advance(req, (size_t) res);
+                    if (req->remaining > 0) {
+                        _bbio_uring_queue(io, slot);
+                        continue;
+                    }
+                }
+
+                req->result = res < 0 ? res : (int64_t) req->done;
+                _bbio_finish(io, slot, &completions[count++]);
+            }
+            __atomic_store_n(io->cq_head, head, __ATOMIC_RELEASE);
+
+            if (count > 0 || !wait || bbio_in_flight(io) == 0) return count;
+            syscall(__NR_io_uring_enter, io->ring_fd, io->to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            io->to_submit = 0;
+        }
+    }
+#endif
+
+    if (io->staged_count > 0) bbio_submit(io);
+
+    unsigned slots[64];
+    size_t taken = 0;
+    if (max > 64) max = 64;
+
+    pthread_mutex_lock(&io->lock);
+    while (wait && io->completed_count == 0 && bbio_in_flight(io) > 0) pthread_cond_wait(&io->work_done, &io->lock);
+    while (io->completed_count > 0 && taken < max) {
+        slots[taken++] = io->completed[io->completed_head];
+        io->completed_head = (io->completed_head + 1) % io->depth;
+        io->completed_count--;
+    }
+    pthread_mutex_unlock(&io->lock);
+
+    for (; count < taken; count++) _bbio_finish(io, slots[count], &completions[count]);
+
+    return count;
+}
+#endif
+
+#ifdef BB_POSIX
+typedef struct {
+    BinBuffer* items[BB_POOL_CLASSES][BB_POOL_THREAD_CACHE];
+    size_t counts[BB_POOL_CLASSES];
+} _BBPoolCache;
+
+static struct {
+    pthread_mutex_t lock;
+    BinBuffer** items[BB_POOL_CLASSES];
+    size_t counts[BB_POOL_CLASSES];
+    size_t slots[BB_POOL_CLASSES];
+} _bb_pool_shared = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static _Thread_local _BBPoolCache _bb_pool_cache;
+static _Thread_local bool _bb_pool_registered;
+static pthread_key_t _bb_pool_key;
+static pthread_once_t _bb_pool_once = PTHREAD_ONCE_INIT;
+
+// true if it went to the shared list, false if caller should destroy it
+static bool _bb_pool_push_shared(BinBuffer* bb, size_t size_class) {
+    bool pushed = false;
+    pthread_mutex_lock(&_bb_pool_shared.lock);
+
+    size_t count = _bb_pool_shared.counts[size_class];
+    if (count < BB_POOL_SHARED_MAX) {
+        if (count == _bb_pool_shared.slots[size_class]) {
+            size_t slots = count ? 2 * count : 16;
+            BinBuffer** items = (BinBuffer**) realloc (_bb_pool_shared.items[size_class], slots * sizeof(BinBuffer*));
+            if (items) {
+                _bb_pool_shared.items[size_class] = items;
+                _bb_pool_shared.slots[size_class] = slots;
+            }
+        }
+        if (count < _bb_pool_shared.slots[size_class]) {
+            _bb_pool_shared.items[size_class][count] = bb;
+            _bb_pool_shared.counts[size_class]++;
+            pushed = true;
+        }
+    }
+
+    pthread_mutex_unlock(&_bb_pool_shared.lock);
+    return pushed;
+}
+
+static void _bb_pool_flush(void* arg) {
+    _BBPoolCache* cache = (_BBPoolCache*) arg;
+    for (size_t c = 0; c < BB_POOL_CLASSES; c++) {
+        while (cache->counts[c] > 0) {
+            BinBuffer* bb = cache->items[c][--cache->counts[c]];
+            if (!_bb_pool_push_shared(bb, c)) bb_destroy(bb);
+        }
+    }
+}
+
+static void _bb_pool_make_key(void) {
+    pthread_key_create(&_bb_pool_key, _bb_pool_flush);
+}
+
+BinBuffer* bb_pool_acquire(size_t capacity) {
+    size_t size_class = 0;
+    while (size_class < BB_POOL_CLASSES && ((size_t) BB_POOL_MIN_SIZE << size_class) < capacity) size_class++;
+    if (size_class == BB_POOL_CLASSES) return bb_create(capacity);
+
+    BinBuffer* bb = NULL;
+    if (_bb_pool_cache.counts[size_class] > 0) {
+        bb = _bb_pool_cache.items[size_class][--_bb_pool_cache.counts[size_class]];
+    } else {
+        pthread_mutex_lock(&_bb_pool_shared.lock);
+        if (_bb_pool_shared.counts[size_class] > 0) {
+            bb = _bb_pool_shared.items[size_class][--_bb_pool_shared.counts[size_class]];
+        }
+        pthread_mutex_unlock(&_bb_pool_shared.lock);
+    }
+
+    if (bb) return bb;
+    return bb_create((size_t) BB_POOL_MIN_SIZE << size_class);
+}
+
+void bb_pool_release(BinBuffer* bb) {
+    if (!bb) return;
+    if (bb->storage != BB_STORAGE_HEAP || bb->capacity < BB_POOL_MIN_SIZE) {
+        bb_destroy(bb);
+        return;
+    }
+
+    // the largest class the buffer can still serve
+    size_t size_class = 0;
+    while (size_class + 1 < BB_POOL_CLASSES && ((size_t) BB_POOL_MIN_SIZE << (size_class + 1)) <= bb->capacity) size_class++;
+    if (bb->capacity >= (size_t) BB_POOL_MIN_SIZE << BB_POOL_CLASSES) {
+        bb_destroy(bb);
+        return;
+    }
+
+    bb_clear(bb);
+    bb->crc32c_tracking = false;
+
+    if (!_bb_pool_registered) {
+        // hands the cache over to the shared lists when this thread exits
+        pthread_once(&_bb_pool_once, _bb_pool_make_key);
+        pthread_setspecific(_bb_pool_key, &_bb_pool_cache);
+        _bb_pool_registered = true;
+    }
+
+    if (_bb_pool_cache.counts[size_class] < BB_POOL_THREAD_CACHE) {
+        _bb_pool_cache.items[size_class][_bb_pool_cache.counts[size_class]++] = bb;
+    } else if (!_bb_pool_push_shared(bb, size_class)) {
+        bb_destroy(bb);
+    }
+}
+
+void bb_pool_trim(void) {
+    for (size_t c = 0; c < BB_POOL_CLASSES; c++) {
+        while (_bb_pool_cache.counts[c] > 0) bb_destroy(_bb_pool_cache.items[c][--_bb_pool_cache.counts[c]]);
+    }
+
+    pthread_mutex_lock(&_bb_pool_shared.lock);
+    for (size_t c = 0; c < BB_POOL_CLASSES; c++) {
+        while (_bb_pool_shared.counts[c] > 0) bb_destroy(_bb_pool_shared.items[c][--_bb_pool_shared.counts[c]]);
+        free(_bb_pool_shared.items[c]);
+        _bb_pool_shared.items[c] = NULL;
+        _bb_pool_shared.slots[c] = 0;
+    }
+    pthread_mutex_unlock(&_bb_pool_shared.lock);
+}
+#endif
+
 #endif
 #endif
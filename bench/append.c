@@ -0,0 +1,77 @@
+/* bench/append.c - bb_append throughput for many small and a few huge appends, grown from empty by the geometric
+ * policy, presized with bb_reserve, and grown to the exact size every time.
+ *
+ * cc -O2 -D_GNU_SOURCE -I.. append.c -o append && ./append [megabytes]
+ */
+
+#define BB_IMPLEMENTATION
+#include "../bb.h"
+
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef enum { GROWN, PRESIZED, EXACT } Policy;
+
+// GB/s appending `total` bytes in `chunk`-sized pieces into a fresh buffer; *grows counts capacity changes
+static double fill(const char* src, size_t chunk, size_t total, Policy policy, size_t* grows) {
+    double best = 0;
+    *grows = 0;
+    for (int r = 0; r < 3; r++) {
+        BinBuffer bb;
+        bb_init(&bb);
+        size_t count = 0;
+
+        double start = now();
+        if (policy == PRESIZED) bb_reserve(&bb, total);
+        for (size_t done = 0; done < total; done += chunk) {
+            size_t capacity = bb.capacity;
+            if (policy == EXACT && bb.length + chunk > bb.capacity) bb_expand(&bb, bb.length + chunk);
+            if (!bb_append(&bb, src, chunk)) {
+                fprintf(stderr, "append of %zu failed\n", chunk);
+                exit(1);
+            }
+            count += bb.capacity != capacity;
+        }
+        double elapsed = now() - start;
+
+        bb_deinit(&bb);
+        if (total / elapsed / 1e9 > best) best = total / elapsed / 1e9;
+        *grows = count;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    size_t total = (size_t)(argc > 1 ? atoi(argv[1]) : 256) << 20;
+    static const size_t chunks[] = { 8, 64, 1024, 65536, (size_t) 16 << 20 };
+
+    char* src = (char*) malloc ((size_t) 16 << 20);
+    memset(src, 'x', (size_t) 16 << 20);
+
+    // half a second of untimed work, otherwise the first row also pays for clock ramp-up
+    size_t grows;
+    for (double until = now() + 0.5; now() < until;) fill(src, 1024, (size_t) 16 << 20, GROWN, &grows);
+
+    printf("%9s %10s %7s %10s %10s %7s\n", "append", "grown GB/s", "grows", "reserve", "exact GB/s", "grows");
+    for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        size_t exact_grows = 0;
+        double grown = fill(src, chunks[c], total, GROWN, &grows);
+        double presized = fill(src, chunks[c], total, PRESIZED, &exact_grows);
+
+        // growing to the exact size on every append is only bearable with few, large appends
+        if (chunks[c] >= 65536) {
+            double exact = fill(src, chunks[c], total, EXACT, &exact_grows);
+            printf("%9zu %10.2f %7zu %10.2f %10.2f %7zu\n", chunks[c], grown, grows, presized, exact, exact_grows);
+        } else {
+            printf("%9zu %10.2f %7zu %10.2f %10s %7s\n", chunks[c], grown, grows, presized, "-", "-");
+        }
+    }
+
+    free(src);
+    return 0;
+}
@@ -0,0 +1,101 @@
+/* bench/chunked.c - append throughput and peak RSS building one large output in a contiguous BinBuffer against a
+ * ChunkedBinBuffer, each variant in its own child process so its peak RSS is its own.
+ *
+ * cc -O2 -D_GNU_SOURCE -I.. chunked.c -o chunked && ./chunked [megabytes]
+ */
+
+#define BB_IMPLEMENTATION
+#include "../bb.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t peak_mib(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (size_t) usage.ru_maxrss / 1024;
+}
+
+// builds `total` bytes from `piece`-sized appends; chunk 0 means a contiguous BinBuffer
+static void run(const char* src, size_t piece, size_t total, size_t chunk) {
+    size_t base = peak_mib();
+    double start = now(), flatten = 0;
+    size_t peak = 0, flat_peak = 0;
+
+    if (chunk == 0) {
+        BinBuffer bb;
+        bb_init(&bb);
+        for (size_t done = 0; done < total; done += piece) bb_append(&bb, src, piece);
+        if (bb.length != total) exit(1);
+        peak = peak_mib() - base;
+        bb_deinit(&bb);
+    } else {
+        ChunkedBinBuffer* cbb = cbb_create(chunk);
+        for (size_t done = 0; done < total; done += piece) cbb_append(cbb, src, piece);
+        if (cbb->length != total) exit(1);
+        peak = peak_mib() - base;
+
+        double flatten_start = now();
+        BinBuffer* flat = cbb_flatten(cbb);
+        flatten = now() - flatten_start;
+        if (!flat || flat->length != total) exit(1);
+        flat_peak = peak_mib() - base;
+        bb_destroy(flat);
+        cbb_destroy(cbb);
+    }
+
+    double elapsed = now() - start - flatten;
+    if (chunk == 0) {
+        printf("%-12s %10.2f %9zu %12s %13s\n", "contiguous", total / elapsed / 1e9, peak, "-", "-");
+    } else {
+        char name[32];
+        snprintf(name, sizeof(name), "chunk %zuK", chunk >> 10);
+        printf("%-12s %10.2f %9zu %12.2f %13zu\n", name, total / elapsed / 1e9, peak, total / flatten / 1e9, flat_peak);
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    size_t total = (size_t)(argc > 1 ? atoi(argv[1]) : 512) << 20;
+    static const size_t chunks[] = { 0, (size_t) 64 << 10, (size_t) 1 << 20, (size_t) 16 << 20 };
+    static const size_t pieces[] = { 64, 4096 };
+
+    char src[4096];
+    memset(src, 'x', sizeof(src));
+
+    // half a second of untimed work, otherwise the first row also pays for clock ramp-up
+    for (double until = now() + 0.5; now() < until;) {
+        BinBuffer bb;
+        bb_init(&bb);
+        for (size_t done = 0; done < ((size_t) 16 << 20); done += 4096) bb_append(&bb, src, 4096);
+        bb_deinit(&bb);
+    }
+
+    // peaks are the growth in max RSS over the child's starting point, once all appends are done and again after
+    // cbb_flatten has copied everything into one contiguous BinBuffer
+    for (size_t p = 0; p < sizeof(pieces) / sizeof(pieces[0]); p++) {
+        printf("%zu MiB in %zu-byte appends\n", total >> 20, pieces[p]);
+        printf("%-12s %10s %9s %12s %13s\n", "buffer", "GB/s", "peak MiB", "flatten GB/s", "flat peak MiB");
+        fflush(stdout);
+        for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                run(src, pieces[p], total, chunks[c]);
+                _exit(0);
+            }
+            int status;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) fprintf(stderr, "child failed\n");
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+/* bench/codec.c - hex and base64 encoders/decoders against straightforward scalar loops.
+ *
+ * cc -O2 -D_GNU_SOURCE -I.. codec.c -o codec && ./codec [megabytes]
+ */
+
+#define BB_IMPLEMENTATION
+#include "../bb.h"
+
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static const char digits[] = "0123456789abcdef";
+static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static size_t scalar_hex(char* out, const unsigned char* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        out[2 * i] = digits[data[i] >> 4];
+        out[2 * i + 1] = digits[data[i] & 15];
+    }
+    return 2 * length;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static size_t scalar_from_hex(char* out, const char* text, size_t length) {
+    for (size_t i = 0; i < length / 2; i++) {
+        int high = hex_value(text[2 * i]), low = hex_value(text[2 * i + 1]);
+        if (high < 0 || low < 0) return 0;
+        out[i] = (char)(high << 4 | low);
+    }
+    return length / 2;
+}
+
+static size_t scalar_base64(char* out, const unsigned char* data, size_t length) {
+    size_t o = 0, i = 0;
+    for (; i + 3 <= length; i += 3) {
+        uint32_t v = (uint32_t) data[i] << 16 | (uint32_t) data[i + 1] << 8 | data[i + 2];
+        out[o++] = alphabet[v >> 18];
+        out[o++] = alphabet[v >> 12 & 63];
+        out[o++] = alphabet[v >> 6 & 63];
+        out[o++] = alphabet[v & 63];
+    }
+    return o;   // inputs here are multiples of 3, no padding needed
+}
+
+#define RUN(label, bytes, expr) do {\
+    double start = now();\
+    volatile size_t sink = 0;\
+    for (int r = 0; r < rounds; r++) sink += (expr);\
+    double seconds = now() - start;\
+    printf("%-28s %8.2f GB/s of binary\n", label, (double) (bytes) * rounds / seconds / 1e9);\
+} while (0)
+
+int main(int argc, char** argv) {
+    size_t size = (size_t)(argc > 1 ? atoi(argv[1]) : 48) << 20;    // a multiple of 3
+    int rounds = 10;
+
+    BinBuffer* raw = bb_create(size);
+    for (size_t i = 0; i < size; i++) bb_append_byte(raw, (char)(i * 2654435761u >> 13));
+
+    BinBuffer* hex = bb_create(2 * size);
+    BinBuffer* b64 = bb_create(size / 3 * 4 + 4);
+    BinBuffer* back = bb_create(size);
+    char* scratch = (char*) malloc (2 * size);
+
+    bb_append_hex(hex, raw->data, size, false);
+    bb_append_base64(b64, raw->data, size);
+
+    // half a second of untimed work, otherwise the first row also pays for clock ramp-up
+    for (double until = now() + 0.5; now() < until;) scalar_hex(scratch, (unsigned char*) raw->data, size);
+
+    RUN("bb_append_hex", size, (hex->length = 0, bb_append_hex(hex, raw->data, size, false)));
+    RUN("scalar hex", size, scalar_hex(scratch, (unsigned char*) raw->data, size));
+    RUN("bb_append_from_hex", size, (back->length = 0, bb_append_from_hex(back, hex->data, hex->length)));
+    RUN("scalar from hex", size, scalar_from_hex(scratch, hex->data, hex->length));
+    RUN("bb_append_base64", size, (b64->length = 0, bb_append_base64(b64, raw->data, size)));
+    RUN("scalar base64", size, scalar_base64(scratch, (unsigned char*) raw->data, size));
+    RUN("bb_append_from_base64", size, (back->length = 0, bb_append_from_base64(back, b64->data, b64->length)));
+
+    if (back->length != size || memcmp(back->data, raw->data, size) != 0) {
+        fprintf(stderr, "round trip mismatch\n");
+        return 1;
+    }
+
+    free(scratch);
+    bb_destroy(raw);
+    bb_destroy(hex);
+    bb_destroy(b64);
+    bb_destroy(back);
+    return 0;
+}
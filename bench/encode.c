@@ -0,0 +1,175 @@
+/* bench/encode.c - encoding and decoding records with the typed encoders and BinReader against hand-rolled
+ * byte-at-a-time appends.
+ *
+ * cc -O2 -D_GNU_SOURCE -I.. encode.c -o encode && ./encode [million records]
+ */
+
+#define BB_IMPLEMENTATION
+#include "../bb.h"
+
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef struct {
+    uint32_t id;
+    uint64_t timestamp;
+    double value;
+    int64_t delta;      // svarint
+    uint64_t count;     // uvarint
+} Record;
+
+// what serializers did before the typed encoders: every byte through bb_append_byte
+static void encode_bytes(BinBuffer* bb, const Record* r) {
+    for (int i = 0; i < 4; i++) bb_append_byte(bb, (char)(r->id >> (8 * i)));
+    for (int i = 0; i < 8; i++) bb_append_byte(bb, (char)(r->timestamp >> (8 * i)));
+    uint64_t bits;
+    memcpy(&bits, &r->value, sizeof(bits));
+    for (int i = 0; i < 8; i++) bb_append_byte(bb, (char)(bits >> (8 * i)));
+
+    uint64_t zigzag = ((uint64_t) r->delta << 1) ^ (uint64_t)(r->delta >> 63);
+    for (; zigzag >= 0x80; zigzag >>= 7) bb_append_byte(bb, (char)(zigzag | 0x80));
+    bb_append_byte(bb, (char) zigzag);
+    uint64_t count = r->count;
+    for (; count >= 0x80; count >>= 7) bb_append_byte(bb, (char)(count | 0x80));
+    bb_append_byte(bb, (char) count);
+}
+
+static void encode_put(BinBuffer* bb, const Record* r) {
+    bb_put_u32_le(bb, r->id);
+    bb_put_u64_le(bb, r->timestamp);
+    bb_put_f64_le(bb, r->value);
+    bb_put_svarint(bb, r->delta);
+    bb_put_uvarint(bb, r->count);
+}
+
+// one capacity check for the whole record, then raw stores
+static void encode_store(BinBuffer* bb, const Record* r) {
+    bb_reserve(bb, 20 + 2 * BB_VARINT_MAX);
+    char* p = bb->data + bb->length;
+    p = bb_store_u32_le(p, r->id);
+    p = bb_store_u64_le(p, r->timestamp);
+    p = bb_store_f64_le(p, r->value);
+    p = bb_store_svarint(p, r->delta);
+    p = bb_store_uvarint(p, r->count);
+    bb->length = p - bb->data;
+}
+
+static uint64_t decode_bytes(BinBuffer* bb) {
+    const unsigned char* p = (const unsigned char*) bb->data;
+    const unsigned char* end = p + bb->length;
+    uint64_t sum = 0;
+    while (p < end) {
+        uint32_t id = 0;
+        for (int i = 0; i < 4; i++) id |= (uint32_t) *p++ << (8 * i);
+        uint64_t timestamp = 0, bits = 0;
+        for (int i = 0; i < 8; i++) timestamp |= (uint64_t) *p++ << (8 * i);
+        for (int i = 0; i < 8; i++) bits |= (uint64_t) *p++ << (8 * i);
+
+        uint64_t zigzag = 0, count = 0;
+        for (int shift = 0; ; shift += 7) { zigzag |= (uint64_t)(*p & 0x7f) << shift; if (!(*p++ & 0x80)) break; }
+        for (int shift = 0; ; shift += 7) { count |= (uint64_t)(*p & 0x7f) << shift; if (!(*p++ & 0x80)) break; }
+        int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+
+        sum += id + timestamp + bits + (uint64_t) delta + count;
+    }
+    return sum;
+}
+
+static uint64_t decode_reader(BinBuffer* bb) {
+    BinReader br = bb_reader(bb);
+    uint64_t sum = 0;
+    while (br_remaining(&br) > 0) {
+        uint32_t id = br_u32_le(&br);
+        uint64_t timestamp = br_u64_le(&br);
+        double value = br_f64_le(&br);
+        int64_t delta = br_svarint(&br);
+        uint64_t count = br_uvarint(&br);
+
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        sum += id + timestamp + bits + (uint64_t) delta + count;
+    }
+    return br_ok(&br) ? sum : 0;
+}
+
+// million records per second, best of three passes; *out keeps the last encoding for decoding and comparing
+static double time_encode(void (*encode)(BinBuffer*, const Record*), const Record* records, size_t count, BinBuffer* out) {
+    double best = 0;
+    for (int r = 0; r < 3; r++) {
+        bb_clear(out);
+        double start = now();
+        for (size_t i = 0; i < count; i++) encode(out, &records[i]);
+        double rate = count / (now() - start) / 1e6;
+        if (rate > best) best = rate;
+    }
+    return best;
+}
+
+static double time_decode(uint64_t (*decode)(BinBuffer*), BinBuffer* bb, size_t count, uint64_t* sum) {
+    double best = 0;
+    for (int r = 0; r < 3; r++) {
+        double start = now();
+        *sum = decode(bb);
+        double rate = count / (now() - start) / 1e6;
+        if (rate > best) best = rate;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    size_t count = (size_t)(argc > 1 ? atoi(argv[1]) : 1) * 1000000;
+
+    // small deltas and counts like a time series, so the varints stay 1-3 bytes
+    Record* records = (Record*) malloc (count * sizeof(Record));
+    uint32_t seed = 1;
+    for (size_t i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        records[i] = (Record) { (uint32_t) i, 1700000000000ull + i * 10, (seed >> 8) / 1e3,
+                                (int64_t)((seed >> 12) % 2001) - 1000, (seed >> 4) % 100000 };
+    }
+
+    BinBuffer* bytes = bb_create(0);
+    BinBuffer* put = bb_create(0);
+    BinBuffer* store = bb_create(0);
+
+    // half a second of untimed work, otherwise the first row also pays for clock ramp-up
+    for (double until = now() + 0.5; now() < until;) time_encode(encode_put, records, count / 10, put);
+
+    double rate_bytes = time_encode(encode_bytes, records, count, bytes);
+    double rate_put = time_encode(encode_put, records, count, put);
+    double rate_store = time_encode(encode_store, records, count, store);
+    if (bytes->length != put->length || memcmp(bytes->data, put->data, put->length) != 0 ||
+        store->length != put->length || memcmp(store->data, put->data, put->length) != 0) {
+        fprintf(stderr, "encodings differ\n");
+        return 1;
+    }
+
+    printf("%zu records, %.1f bytes each\n\n", count, (double) put->length / count);
+    printf("%-26s %10s\n", "encode", "M rec/s");
+    printf("%-26s %10.1f\n", "bb_append_byte per byte", rate_bytes);
+    printf("%-26s %10.1f\n", "bb_put_* per field", rate_put);
+    printf("%-26s %10.1f\n", "bb_reserve + bb_store_*", rate_store);
+
+    uint64_t sum_bytes, sum_reader;
+    double decode_raw = time_decode(decode_bytes, put, count, &sum_bytes);
+    double decode_br = time_decode(decode_reader, put, count, &sum_reader);
+    if (sum_bytes != sum_reader) {
+        fprintf(stderr, "decodings differ\n");
+        return 1;
+    }
+
+    printf("\n%-26s %10s\n", "decode", "M rec/s");
+    printf("%-26s %10.1f\n", "hand-rolled byte loop", decode_raw);
+    printf("%-26s %10.1f\n", "BinReader", decode_br);
+
+    bb_destroy(bytes);
+    bb_destroy(put);
+    bb_destroy(store);
+    free(records);
+    return 0;
+}
@@ -0,0 +1,68 @@
+/* bench/format.c - bb_append_u64 / bb_append_i64 / bb_append_f64 against bb_appendf with the printf equivalent.
+ *
+ * cc -O2 -D_GNU_SOURCE -I.. format.c -o format && ./format [million values]
+ */
+
+#define BB_IMPLEMENTATION
+#include "../bb.h"
+
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ns per appended value; the buffer is reset every 4096 values so it stays in cache
+#define RUN(label, count, append) do {\
+    double start = now();\
+    for (size_t i = 0; i < (count); i++) {\
+        if ((i & 4095) == 0) out->length = 0;\
+        append;\
+    }\
+    printf("%-28s %8.1f ns\n", label, (now() - start) / (count) * 1e9);\
+} while (0)
+
+int main(int argc, char** argv) {
+    size_t count = (size_t) (argc > 1 ? atoi(argv[1]) : 4) * 1000000;
+    BinBuffer* out = bb_create(4096 * 32);
+
+    // mixed magnitudes, so digit counting isn't always the same branch
+    uint64_t* integers = (uint64_t*) malloc (count * sizeof(uint64_t));
+    double* doubles = (double*) malloc (count * sizeof(double));
+    uint64_t seed = 88172645463325252ull;
+    for (size_t i = 0; i < count; i++) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        integers[i] = seed >> (seed % 60);
+        doubles[i] = (double) (seed >> 11) / (1ull << 53) * (double) (1ull << (seed % 40));
+    }
+
+    // a fast but wrong f64 would make the comparison meaningless, so check sampled round trips first
+    for (size_t i = 0; i < count; i += 997) {
+        out->length = 0;
+        bb_append_f64(out, doubles[i]);
+        if (strtod(bb_cstr(out), NULL) != doubles[i]) {
+            fprintf(stderr, "bb_append_f64 round trip failed for %.17g\n", doubles[i]);
+            return 1;
+        }
+    }
+
+    // half a second of untimed work, otherwise the first row also pays for clock ramp-up
+    for (double until = now() + 0.5; now() < until;) {
+        out->length = 0;
+        for (size_t i = 0; i < 4096; i++) bb_append_u64(out, integers[i % count]);
+    }
+
+    RUN("bb_append_u64", count, bb_append_u64(out, integers[i]));
+    RUN("bb_appendf(\"%llu\")", count, bb_appendf(out, "%llu", (unsigned long long) integers[i]));
+    RUN("bb_append_i64", count, bb_append_i64(out, (int64_t) integers[i] * ((i & 1) ? -1 : 1)));
+    RUN("bb_appendf(\"%lld\")", count, bb_appendf(out, "%lld", (long long) integers[i] * ((i & 1) ? -1 : 1)));
+    RUN("bb_append_f64", count, bb_append_f64(out, doubles[i]));
+    RUN("bb_appendf(\"%.17g\")", count, bb_appendf(out, "%.17g", doubles[i]));
+
+    free(integers);
+    free(doubles);
+    bb_destroy(out);
+    return 0;
+}
@@ -0,0 +1,317 @@
+/* bench/ht.c - lookup cost and heap use of the HashTable modes against load factor, and HT_CONCURRENT under mixed load,
+ * and HashTableRcu reads while a writer keeps republishing.
+ *
+ * cc -O2 -D_GNU_SOURCE -pthread -I.. ht.c -o ht && ./ht [log2 slots]
+ */
+
+#define HT_IMPLEMENTATION
+#include "../ht.h"
+
+#include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static char** make_keys(uint64_t count, const char* prefix) {
+    char** keys = (char**) malloc (count * sizeof(char*));
+    for (uint64_t i = 0; i < count; i++) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%s%llu", prefix, (unsigned long long) i);
+        keys[i] = strdup(buffer);
+    }
+
+    // shuffle so lookups don't walk the keys in insertion order
+    uint64_t seed = 88172645463325252ull;
+    for (uint64_t i = count - 1; i > 0; i--) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        uint64_t j = seed % (i + 1);
+        char* tmp = keys[i]; keys[i] = keys[j]; keys[j] = tmp;
+    }
+    return keys;
+}
+
+// nanoseconds per ht_get over `count` keys, repeated until at least 0.2 s has passed
+static double time_lookups(HashTable* ht, char** keys, uint64_t count, bool expect_hit) {
+    uint64_t lookups = 0;
+    double start = now(), elapsed;
+    do {
+        for (uint64_t i = 0; i < count; i++) {
+            if ((ht_get(ht, keys[i]) != NULL) != expect_hit) {
+                fprintf(stderr, "unexpected %s for %s\n", expect_hit ? "miss" : "hit", keys[i]);
+                exit(1);
+            }
+        }
+        lookups += count;
+        elapsed = now() - start;
+    } while (elapsed < 0.2);
+    return elapsed / lookups * 1e9;
+}
+
+typedef struct {
+    HashTable* ht;
+    char** keys;
+    uint64_t count;
+    unsigned write_percent;
+    uint64_t seed;
+    uint64_t ops;
+} MixedWorker;
+
+static int stop;
+static int value;
+
+// random ht_get, with write_percent of operations removing a key and putting it straight back
+static void* mixed_worker(void* arg) {
+    MixedWorker* w = (MixedWorker*) arg;
+    uint64_t seed = w->seed;
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+        for (int batch = 0; batch < 1024; batch++) {
+            seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+            const char* key = w->keys[(seed >> 8) % w->count];
+            if (seed % 100 < w->write_percent) {
+                ht_remove(w->ht, key);
+                ht_set(w->ht, key, &value);
+            } else {
+                ht_get(w->ht, key);
+            }
+        }
+        w->ops += 1024;
+    }
+    return NULL;
+}
+
+// million operations per second over all threads
+static double time_mixed(HashTable* ht, char** keys, uint64_t count, int threads, unsigned write_percent) {
+    pthread_t ids[64];
+    MixedWorker workers[64];
+
+    __atomic_store_n(&stop, 0, __ATOMIC_RELAXED);
+    for (int t = 0; t < threads; t++) {
+        workers[t] = (MixedWorker) { ht, keys, count, write_percent, 0x9e3779b97f4a7c15ull * (t + 1), 0 };
+        pthread_create(&ids[t], NULL, mixed_worker, &workers[t]);
+    }
+
+    double start = now();
+    usleep(300000);
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+
+    uint64_t ops = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+        ops += workers[t].ops;
+    }
+    double elapsed = now() - start;
+
+    ht_reclaim(ht);
+    return ops / elapsed / 1e6;
+}
+
+typedef struct {
+    HashTableRcu* rcu;
+    char** keys;
+    uint64_t count;
+    bool plain;     // baseline: look the table up once and never announce quiescence
+    uint64_t seed;
+    uint64_t ops;
+} RcuWorker;
+
+// ht_get through ht_rcu_current, announcing a quiescent point every 1024 lookups as a request loop would
+static void* rcu_reader(void* arg) {
+    RcuWorker* w = (RcuWorker*) arg;
+    HashTableRcuReader* reader = ht_rcu_register(w->rcu);
+    HashTable* fixed = ht_rcu_current(w->rcu);
+    uint64_t seed = w->seed;
+    while (!__atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+        for (int batch = 0; batch < 1024; batch++) {
+            seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+            HashTable* ht = w->plain ? fixed : ht_rcu_current(w->rcu);
+            if (ht_get(ht, w->keys[(seed >> 8) % w->count]) == NULL) {
+                fprintf(stderr, "rcu: published table lost a key\n");
+                exit(1);
+            }
+        }
+        if (!w->plain) ht_rcu_quiescent(reader);
+        w->ops += 1024;
+    }
+    ht_rcu_unregister(reader);
+    return NULL;
+}
+
+static HashTable* rcu_snapshot(char** keys, uint64_t count) {
+    HashTable* ht = ht_create_mode(count, NULL, HT_CUCKOO);
+    for (uint64_t i = 0; i < count; i++) ht_set(ht, keys[i], &value);
+    return ht;
+}
+
+// reader Mops/s over all threads while the calling thread publishes a rebuilt snapshot every `interval` us
+// (0 = back to back, -1 = never); publishes per second go to *published
+static double time_rcu(char** keys, uint64_t count, int threads, int interval, bool plain, double* published) {
+    pthread_t ids[64];
+    RcuWorker workers[64];
+    HashTableRcu* rcu = ht_rcu_create(rcu_snapshot(keys, count));
+
+    __atomic_store_n(&stop, 0, __ATOMIC_RELAXED);
+    for (int t = 0; t < threads; t++) {
+        workers[t] = (RcuWorker) { rcu, keys, count, plain, 0x9e3779b97f4a7c15ull * (t + 1), 0 };
+        pthread_create(&ids[t], NULL, rcu_reader, &workers[t]);
+    }
+
+    uint64_t publishes = 0;
+    double start = now(), until = start + 0.3;
+    if (interval < 0) {
+        usleep(300000);
+    } else {
+        while (now() < until) {
+            ht_rcu_publish(rcu, rcu_snapshot(keys, count));
+            publishes++;
+            if (interval > 0) usleep(interval);
+        }
+    }
+    __atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+
+    uint64_t ops = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+        ops += workers[t].ops;
+    }
+    double elapsed = now() - start;
+
+    ht_rcu_synchronize(rcu);
+    ht_rcu_destroy(rcu);
+    *published = publishes / elapsed;
+    return ops / elapsed / 1e6;
+}
+
+static const struct { const char* name; HashTableMode mode; } modes[] = {
+    { "linear", HT_LINEAR },
+    { "cuckoo", HT_CUCKOO },
+    { "hopscotch", HT_HOPSCOTCH },
+    { "compact", HT_COMPACT },
+};
+
+int main(int argc, char** argv) {
+    uint64_t slots = 1ull << (argc > 1 ? atoi(argv[1]) : 20);
+    static const double loads[] = { 0.5, 0.75, 0.9, 0.95 };
+
+    // twice the slots, since a mode may round its capacity up past `slots`
+    uint64_t keys = slots * 2;
+    char** present = make_keys(keys, "key:");
+    char** absent = make_keys(keys, "missing:");
+
+    // half a second of untimed work, otherwise the first row also pays for clock ramp-up
+    for (double until = now() + 0.5; now() < until;) {
+        HashTable* warm = ht_create(slots, NULL);
+        for (uint64_t i = 0; i < slots / 2; i++) ht_set(warm, present[i], &value);
+        ht_destroy(warm);
+    }
+
+    printf("%-10s %5s %10s %10s %10s\n", "mode", "load", "slots", "hit ns", "miss ns");
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        for (size_t l = 0; l < sizeof(loads) / sizeof(loads[0]); l++) {
+            // fill against the capacity the mode actually allocated, which cuckoo rounds up to whole buckets
+            HashTable* ht = ht_create_mode(slots, NULL, modes[m].mode);
+            uint64_t count = (uint64_t) (loads[l] * ht->capacity);
+            for (uint64_t i = 0; i < count; i++) {
+                if (!ht_set(ht, present[i], &value)) {
+                    fprintf(stderr, "%s: ht_set failed\n", modes[m].name);
+                    return 1;
+                }
+            }
+
+            // a fixed-size sample keeps rows short; the sampled keys are still spread over the whole table
+            uint64_t sample = count < 1u << 18 ? count : 1u << 18;
+            printf("%-10s %5.2f %10llu %10.1f %10.1f\n", modes[m].name, (double) ht->length / ht->capacity,
+                   (unsigned long long) ht->capacity,
+                   time_lookups(ht, present, sample, true), time_lookups(ht, absent, sample, false));
+            ht_destroy(ht);
+        }
+    }
+
+    // tables grown from empty, so each mode settles at its own capacity; heap bytes include the keys
+    uint64_t entries = slots / 2;
+    printf("\n%-10s %10s %10s %12s %10s\n", "mode", "entries", "slots", "bytes/entry", "hit ns");
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        size_t before = mallinfo2().uordblks;
+        HashTable* ht = ht_create_mode(16, NULL, modes[m].mode);
+        for (uint64_t i = 0; i < entries; i++) ht_set(ht, present[i], &value);
+        size_t heap = mallinfo2().uordblks - before;
+
+        uint64_t sample = entries < 1u << 18 ? entries : 1u << 18;
+        printf("%-10s %10llu %10llu %12.1f %10.1f\n", modes[m].name, (unsigned long long) ht->length,
+               (unsigned long long) ht->capacity, (double) heap / ht->length, time_lookups(ht, present, sample, true));
+        ht_destroy(ht);
+    }
+
+    // linear and compact sized up front and filled to the same load, so bytes/entry compares the layouts rather
+    // than where each one happens to grow; heap bytes include the keys
+    static const double fills[] = { 0.5, 0.75, 0.9 };
+    printf("\n%-10s %5s %10s %12s %10s\n", "mode", "load", "entries", "bytes/entry", "hit ns");
+    for (size_t l = 0; l < sizeof(fills) / sizeof(fills[0]); l++) {
+        for (size_t m = 0; m < 2; m++) {
+            HashTableMode mode = m == 0 ? HT_LINEAR : HT_COMPACT;
+            size_t before = mallinfo2().uordblks;
+            HashTable* ht = ht_create_mode(slots, NULL, mode);
+            uint64_t count = (uint64_t) (fills[l] * ht->capacity);
+            for (uint64_t i = 0; i < count; i++) ht_set(ht, present[i], &value);
+            size_t heap = mallinfo2().uordblks - before;
+
+            uint64_t sample = count < 1u << 18 ? count : 1u << 18;
+            printf("%-10s %5.2f %10llu %12.1f %10.1f\n", mode == HT_LINEAR ? "linear" : "compact",
+                   (double) ht->length / ht->capacity, (unsigned long long) ht->length, (double) heap / ht->length,
+                   time_lookups(ht, present, sample, true));
+            ht_destroy(ht);
+        }
+    }
+
+    // HT_CUCKOO is the single-threaded baseline for the same layout without versions and locks
+    static const unsigned write_percents[] = { 1, 10 };
+    static const int thread_counts[] = { 1, 2, 4 };
+    printf("\n%-10s %7s %7s %10s\n", "mode", "threads", "writes", "Mops/s");
+    for (size_t w = 0; w < sizeof(write_percents) / sizeof(write_percents[0]); w++) {
+        for (size_t m = 0; m < 2; m++) {
+            HashTableMode mode = m == 0 ? HT_CUCKOO : HT_CONCURRENT;
+            for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+                if (mode == HT_CUCKOO && thread_counts[t] > 1) break;
+
+                uint64_t count = slots / 2;
+                HashTable* ht = ht_create_mode(slots, NULL, mode);
+                for (uint64_t i = 0; i < count; i++) ht_set(ht, present[i], &value);
+
+                printf("%-10s %7d %6u%% %10.2f\n", mode == HT_CUCKOO ? "cuckoo" : "concurrent", thread_counts[t],
+                       write_percents[w], time_mixed(ht, present, count, thread_counts[t], write_percents[w]));
+                ht_destroy(ht);
+            }
+        }
+    }
+
+    // 64K-key HT_CUCKOO snapshots; the same readers calling plain ht_get on a table that never changes are the baseline
+    uint64_t snapshot = slots < 1u << 16 ? slots : 1u << 16;
+    static const struct { const char* name; int interval; bool plain; } publishers[] = {
+        { "plain ht_get", -1, true },
+        { "none", -1, false },
+        { "every 10 ms", 10000, false },
+        { "back to back", 0, false },
+    };
+    printf("\n%-22s %7s %10s %10s\n", "rcu publisher", "readers", "Mops/s", "publish/s");
+    for (size_t p = 0; p < sizeof(publishers) / sizeof(publishers[0]); p++) {
+        for (int threads = 1; threads <= 2; threads++) {
+            double published;
+            double reads = time_rcu(present, snapshot, threads, publishers[p].interval, publishers[p].plain, &published);
+            printf("%-22s %7d %10.2f %10.0f\n", publishers[p].name, threads, reads, published);
+        }
+    }
+
+    for (uint64_t i = 0; i < keys; i++) {
+        free(present[i]);
+        free(absent[i]);
+    }
+    free(present);
+    free(absent);
+    return 0;
+}
@@ -0,0 +1,111 @@
+/* bench/io.c - writing a file from many BinBuffers through BinBufferIO at queue depths 1 to 64, with io_uring and
+ * with the worker thread fallback, against one blocking bb_write_fd per buffer. Runs on tmpfs and on a directory of
+ * the local disk; disk times include the closing fdatasync.
+ *
+ * cc -O2 -D_GNU_SOURCE -pthread -I.. io.c -o io && ./io [megabytes] [disk directory]
+ */
+
+#define BB_IMPLEMENTATION
+#include "../bb.h"
+
+#include <fcntl.h>
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// MB/s writing `total` bytes as `size`-byte buffers; depth 0 means blocking writes, one buffer at a time
+static double flush(const char* path, bool sync, size_t size, size_t total, unsigned depth, bool uring) {
+    size_t slots = depth ? depth : 1, count = total / size;
+    BinBuffer* bufs[64];
+    for (size_t i = 0; i < slots; i++) {
+        bufs[i] = bb_create(size);
+        memset(bb_claim(bufs[i], size), 'a' + (int) i, size);
+    }
+
+    double best = 0;
+    for (int r = 0; r < 3; r++) {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0) {
+            perror(path);
+            exit(1);
+        }
+
+        double start = now();
+        if (depth == 0) {
+            for (size_t i = 0; i < count; i++) {
+                if (!bb_write_fd(bufs[0], fd)) exit(1);
+            }
+        } else {
+            BinBufferIO* io = bbio_create(depth, uring);
+            if (!io || io->uring != uring) {
+                fprintf(stderr, "no %s BinBufferIO\n", uring ? "io_uring" : "thread");
+                exit(1);
+            }
+
+            // keep every slot busy: each completion resubmits its buffer at the next free offset
+            size_t next = 0, done = 0;
+            for (; next < slots && next < count; next++) bbio_write(io, fd, bufs[next], next * size, next);
+            bbio_submit(io);
+            while (done < count) {
+                BinBufferIOCompletion completions[64];
+                size_t n = bbio_poll(io, completions, 64, true);
+                for (size_t i = 0; i < n; i++) {
+                    if (completions[i].result != (int64_t) size) {
+                        fprintf(stderr, "write failed: %lld\n", (long long) completions[i].result);
+                        exit(1);
+                    }
+                    done++;
+                    if (next < count) {
+                        bbio_write(io, fd, bufs[completions[i].user_data], next * size, completions[i].user_data);
+                        next++;
+                    }
+                }
+                bbio_submit(io);
+            }
+            bbio_destroy(io);
+        }
+        if (sync) fdatasync(fd);
+        double elapsed = now() - start;
+
+        close(fd);
+        unlink(path);
+        if (total / elapsed / 1e6 > best) best = total / elapsed / 1e6;
+    }
+
+    for (size_t i = 0; i < slots; i++) bb_destroy(bufs[i]);
+    return best;
+}
+
+int main(int argc, char** argv) {
+    size_t total = (size_t)(argc > 1 ? atoi(argv[1]) : 128) << 20;
+    const char* disk = argc > 2 ? argv[2] : ".";
+    static const size_t sizes[] = { 4096, 131072 };
+    static const unsigned depths[] = { 1, 4, 16, 64 };
+
+    char disk_path[4096];
+    snprintf(disk_path, sizeof(disk_path), "%s/bb-io-bench", disk);
+    const char* paths[] = { "/dev/shm/bb-io-bench", disk_path };
+    const char* targets[] = { "tmpfs", "disk" };
+
+    // half a second of untimed work, otherwise the first row also pays for clock ramp-up
+    for (double until = now() + 0.5; now() < until;) flush(paths[0], false, 65536, (size_t) 16 << 20, 4, true);
+
+    printf("%-6s %7s %6s %12s %12s\n", "target", "size", "depth", "uring MB/s", "thread MB/s");
+    for (size_t t = 0; t < 2; t++) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            printf("%-6s %7zu %6s %12.0f %12s\n", targets[t], sizes[s], "write", flush(paths[t], t == 1, sizes[s], total, 0, false), "-");
+            for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+                printf("%-6s %7zu %6u %12.0f %12.0f\n", targets[t], sizes[s], depths[d],
+                       flush(paths[t], t == 1, sizes[s], total, depths[d], true),
+                       flush(paths[t], t == 1, sizes[s], total, depths[d], false));
+                fflush(stdout);
+            }
+        }
+    }
+
+    return 0;
+}
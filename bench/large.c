@@ -0,0 +1,112 @@
+/* bench/large.c - growing a buffer to 1 GiB by appending and then scanning it, on the heap (realloc), in an anonymous
+ * mapping grown with mremap, and in one with transparent huge pages requested.
+ *
+ * cc -O2 -D_GNU_SOURCE -I.. large.c -o large && ./large [megabytes]
+ */
+
+#define BB_IMPLEMENTATION
+#include "../bb.h"
+
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// AnonHugePages of the whole process, in MiB
+static size_t huge_mib(void) {
+    FILE* f = fopen("/proc/self/smaps_rollup", "r");
+    char line[128];
+    size_t kib = 0;
+    while (f && fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "AnonHugePages: %zu kB", &kib) == 1) break;
+    }
+    if (f) fclose(f);
+    return kib >> 10;
+}
+
+typedef enum { HEAP, ANON, HUGE } Kind;
+
+static const char* names[] = { "heap", "bb_create_large", "bb_create_large huge" };
+
+static volatile uint64_t sink;    // keeps the scans from being optimized away
+
+static void run(Kind kind, const char* src, size_t piece, size_t total) {
+    BinBuffer* bb = kind == HEAP ? bb_create(piece) : bb_create_large(piece, kind == HUGE);
+    if (!bb) {
+        fprintf(stderr, "%s: create failed\n", names[kind]);
+        exit(1);
+    }
+
+    // fill time includes faulting in every page; grow time is only the bb_reserve calls that changed capacity
+    size_t grows = 0, moves = 0;
+    double grow = 0, start = now();
+    for (size_t done = 0; done < total; done += piece) {
+        if (bb->capacity - bb->length < piece) {
+            char* data = bb->data;
+            double grow_start = now();
+            if (!bb_reserve(bb, piece)) {
+                fprintf(stderr, "%s: grow to %zu failed\n", names[kind], bb->length + piece);
+                exit(1);
+            }
+            grow += now() - grow_start;
+            grows++;
+            moves += bb->data != data;
+        }
+        memcpy(bb->data + bb->length, src, piece);
+        bb->length += piece;
+    }
+    double fill = now() - start;
+    size_t huge = huge_mib();
+
+    // sequential: sum every 8-byte word; random: one dependent 8-byte load per step, where the TLB shows
+    uint64_t sum = 0;
+    double scan = 1e9;
+    for (int r = 0; r < 3; r++) {
+        double scan_start = now();
+        const uint64_t* words = (const uint64_t*) bb->data;
+        for (size_t i = 0; i < total / 8; i++) sum += words[i];
+        if (now() - scan_start < scan) scan = now() - scan_start;
+    }
+
+    size_t steps = 10000000, index = 0;
+    start = now();
+    for (size_t i = 0; i < steps; i++) {
+        uint64_t word;
+        memcpy(&word, bb->data + index, 8);
+        index = (index * 6364136223846793005ull + word + 1442695040888963407ull) % (total - 8);
+    }
+    double random = now() - start;
+    sink = sum + index;
+
+    printf("%-21s %8.2f %6zu %6zu %8.1f %8.2f %10.1f %9zu\n", names[kind], total / fill / 1e9, grows, moves,
+           grow * 1e3, total / scan / 1e9, steps / random / 1e6, huge);
+    fflush(stdout);
+    bb_destroy(bb);
+}
+
+int main(int argc, char** argv) {
+    size_t total = (size_t)(argc > 1 ? atoi(argv[1]) : 1024) << 20;
+    size_t piece = (size_t) 1 << 20;
+
+    char* src = (char*) malloc (piece);
+    memset(src, 1, piece);
+
+    // half a second of untimed work, otherwise the first row also pays for clock ramp-up
+    for (double until = now() + 0.5; now() < until;) {
+        BinBuffer* bb = bb_create(piece);
+        for (int i = 0; i < 16; i++) bb_append(bb, src, piece);
+        bb_destroy(bb);
+    }
+
+    // growth is geometric from 1 MiB in all three; huge pages are the process-wide AnonHugePages after the fill
+    printf("%zu MiB in %zu KiB appends\n", total >> 20, piece >> 10);
+    printf("%-21s %8s %6s %6s %8s %8s %10s %9s\n", "buffer", "fill GB/s", "grows", "moves", "grow ms", "scan GB/s",
+           "random M/s", "huge MiB");
+    for (int k = HEAP; k <= HUGE; k++) run((Kind) k, src, piece, total);
+
+    free(src);
+    return 0;
+}
@@ -0,0 +1,56 @@
+/* bench/pool.c - bb_pool_acquire / bb_pool_release against bb_create / bb_destroy.
+ *
+ * cc -O2 -D_GNU_SOURCE -pthread -I.. pool.c -o pool && ./pool
+ */
+
+#define BB_IMPLEMENTATION
+#include "../bb.h"
+
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ns per acquire + fill + release cycle, holding `live` buffers at a time like a request handler would
+static double cycle(size_t capacity, size_t live, bool pooled) {
+    BinBuffer* held[64];
+    size_t rounds = 0;
+    double start = now(), elapsed;
+    do {
+        for (int r = 0; r < 1000; r++) {
+            for (size_t i = 0; i < live; i++) {
+                held[i] = pooled ? bb_pool_acquire(capacity) : bb_create(capacity);
+                memset(bb_claim(held[i], 64), 'x', 64);
+            }
+            for (size_t i = 0; i < live; i++) {
+                if (pooled) bb_pool_release(held[i]);
+                else bb_destroy(held[i]);
+            }
+        }
+        rounds += 1000 * live;
+        elapsed = now() - start;
+    } while (elapsed < 0.3);
+    return elapsed / rounds * 1e9;
+}
+
+int main(void) {
+    static const size_t capacities[] = { 256, 4096, 65536 };
+    static const size_t lives[] = { 1, 16 };
+
+    // half a second of untimed work, otherwise the first row also pays for clock ramp-up
+    for (double until = now() + 0.5; now() < until;) cycle(4096, 1, false);
+
+    printf("%8s %5s %12s %12s\n", "capacity", "live", "create ns", "pool ns");
+    for (size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); c++) {
+        for (size_t l = 0; l < sizeof(lives) / sizeof(lives[0]); l++) {
+            printf("%8zu %5zu %12.1f %12.1f\n", capacities[c], lives[l],
+                   cycle(capacities[c], lives[l], false), cycle(capacities[c], lives[l], true));
+        }
+    }
+
+    bb_pool_trim();
+    return 0;
+}
@@ -0,0 +1,135 @@
+/* bench/ring.c - parsing a stream of length-prefixed frames in place as it arrives in fixed-size reads: a BinBuffer
+ * compacted with memmove after every read, one compacted only when the next read doesn't fit, and a BinRing.
+ *
+ * cc -O2 -D_GNU_SOURCE -I.. ring.c -o ring && ./ring [megabytes]
+ */
+
+#define BB_IMPLEMENTATION
+#include "../bb.h"
+
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef enum { EVERY, WHEN_FULL, RING } Mode;
+
+static const char* names[] = { "memmove every read", "memmove when full", "BinRing" };
+
+// consumes every complete frame at the front of data, returns the bytes consumed; frames are a u32 length and a
+// payload, of which the parser only looks at the first 8 bytes, like a header
+static size_t parse(const char* data, size_t length, uint64_t* check) {
+    size_t pos = 0;
+    while (length - pos >= 4) {
+        uint32_t size;
+        memcpy(&size, data + pos, 4);
+        if (length - pos - 4 < size) break;
+
+        uint64_t head;
+        memcpy(&head, data + pos + 4, 8);
+        *check += head ^ size;
+        pos += 4 + size;
+    }
+    return pos;
+}
+
+// GB/s feeding `stream` through a `capacity`-byte buffer in `read`-sized pieces; *moved counts memmoved bytes
+static double feed(Mode mode, const char* stream, size_t total, size_t read, size_t capacity, size_t* moved,
+                   uint64_t* check) {
+    double best = 0;
+    for (int r = 0; r < 3; r++) {
+        BinBuffer* bb = bb_create(capacity);
+        BinRing* ring = bbr_create(capacity);
+        size_t pos = 0;     // parsed prefix of bb
+        *moved = 0;
+        *check = 0;
+
+        double start = now();
+        for (size_t done = 0; done < total;) {
+            size_t n = total - done < read ? total - done : read;
+            if (mode == RING) {
+                size_t available = 0;
+                char* dst = bbr_write_span(ring, &available);
+                if (n > available) exit(1);
+                memcpy(dst, stream + done, n);
+                bbr_produce(ring, n);
+
+                const char* src = bbr_read_span(ring, &available);
+                bbr_consume(ring, parse(src, available, check));
+            } else {
+                if (pos > 0 && (mode == EVERY || bb->capacity - bb->length < n)) {
+                    memmove(bb->data, bb->data + pos, bb->length - pos);
+                    *moved += bb->length - pos;
+                    bb->length -= pos;
+                    pos = 0;
+                }
+                if (bb->capacity - bb->length < n) exit(1);
+                memcpy(bb->data + bb->length, stream + done, n);
+                bb->length += n;
+
+                pos += parse(bb->data + pos, bb->length - pos, check);
+            }
+            done += n;
+        }
+        double elapsed = now() - start;
+
+        bb_destroy(bb);
+        bbr_destroy(ring);
+        if (total / elapsed / 1e9 > best) best = total / elapsed / 1e9;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    size_t size = (size_t)(argc > 1 ? atoi(argv[1]) : 256) << 20;
+    static const size_t frames[] = { 4096, 61440 };
+    static const size_t reads[] = { 1500, 65536 };
+    static const size_t capacities[] = { (size_t) 128 << 10, (size_t) 1 << 20 };
+
+    char* stream = (char*) malloc (size);
+    size_t moved;
+    uint64_t check, expected = 0;
+
+    printf("%7s %6s %9s %-20s %8s %11s\n", "frames", "read", "capacity", "buffer", "GB/s", "moved MiB");
+    for (size_t f = 0; f < sizeof(frames) / sizeof(frames[0]); f++) {
+        // payloads of 16 bytes up to the frame size; the stream ends on a frame boundary so every mode parses all of it
+        uint32_t seed = 1;
+        size_t total = 0;
+        for (;;) {
+            seed = seed * 1103515245 + 12345;
+            uint32_t length = 16 + (seed >> 8) % (frames[f] - 15);
+            if (total + 4 + length > size) break;
+            memcpy(stream + total, &length, 4);
+            memset(stream + total + 4, (char) seed, length);
+            total += 4 + length;
+        }
+
+        // half a second of untimed work, otherwise the first row also pays for clock ramp-up
+        if (f == 0) {
+            for (double until = now() + 0.5; now() < until;) {
+                feed(RING, stream, total / 16, 16384, 1 << 20, &moved, &check);
+            }
+        }
+
+        for (size_t c = 0; c < sizeof(capacities) / sizeof(capacities[0]); c++) {
+            for (size_t r = 0; r < sizeof(reads) / sizeof(reads[0]); r++) {
+                for (int m = EVERY; m <= RING; m++) {
+                    double rate = feed((Mode) m, stream, total, reads[r], capacities[c], &moved, &check);
+                    if (m == EVERY) expected = check;
+                    else if (check != expected) {
+                        fprintf(stderr, "%s parsed different frames\n", names[m]);
+                        return 1;
+                    }
+                    printf("%6zuK %6zu %8zuK %-20s %8.2f %11.1f\n", frames[f] >> 10, reads[r], capacities[c] >> 10,
+                           names[m], rate, moved / 1048576.0);
+                }
+            }
+        }
+    }
+
+    free(stream);
+    return 0;
+}
@@ -0,0 +1,65 @@
+/* bench/search.c - bb_find_byte / bb_find_any / bb_find_substr against plain loops and memmem.
+ *
+ * cc -O2 -D_GNU_SOURCE -I.. search.c -o search && ./search [megabytes]
+ */
+
+#define BB_IMPLEMENTATION
+#include "../bb.h"
+
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t naive_find_any(const char* data, size_t length, const char* set, size_t set_length) {
+    for (size_t i = 0; i < length; i++) {
+        for (size_t j = 0; j < set_length; j++) {
+            if (data[i] == set[j]) return i;
+        }
+    }
+    return length;
+}
+
+static size_t naive_find_substr(const char* data, size_t length, const char* needle, size_t needle_length) {
+    for (size_t i = 0; i + needle_length <= length; i++) {
+        if (memcmp(data + i, needle, needle_length) == 0) return i;
+    }
+    return length;
+}
+
+#define RUN(label, expr) do {\
+    double start = now();\
+    volatile size_t sink = 0;\
+    for (int r = 0; r < rounds; r++) sink += (expr);\
+    double seconds = now() - start;\
+    printf("%-28s %8.2f GB/s\n", label, (double) size * rounds / seconds / 1e9);\
+} while (0)
+
+int main(int argc, char** argv) {
+    size_t size = (size_t)(argc > 1 ? atoi(argv[1]) : 64) << 20;
+    int rounds = 10;
+
+    // lowercase text with the match at the very end, so every search scans the whole buffer
+    BinBuffer* bb = bb_create(size);
+    for (size_t i = 0; i < size; i++) bb_append_byte(bb, 'a' + (char)(i * 7 % 23));
+    memcpy(bb->data + size - 8, "|needle!", 8);
+
+    // half a second of untimed scanning, otherwise whichever row runs first also pays for clock ramp-up
+    for (double until = now() + 0.5; now() < until;) {
+        if (memchr(bb->data, '#', size)) return 1;
+    }
+
+    RUN("bb_find_byte", bb_find_byte(bb, 0, '|'));
+    RUN("memchr", (size_t)((char*) memchr(bb->data, '|', size) - bb->data));
+    RUN("bb_find_any (4 bytes)", bb_find_any(bb, 0, "|{}~", 4));
+    RUN("naive find_any (4 bytes)", naive_find_any(bb->data, size, "|{}~", 4));
+    RUN("bb_find_substr", bb_find_substr(bb, 0, "needle", 6));
+    RUN("memmem", (size_t)((char*) memmem(bb->data, size, "needle", 6) - bb->data));
+    RUN("naive find_substr", naive_find_substr(bb->data, size, "needle", 6));
+
+    bb_destroy(bb);
+    return 0;
+}
@@ -0,0 +1,79 @@
+/* bench/small.c - create / append / destroy cycles for short-lived small buffers: a struct and a data allocation
+ * (bb_adopt), bb_create with its inline storage, bb_init_inline on the stack and bb_init on the stack.
+ *
+ * cc -O2 -D_GNU_SOURCE -I.. small.c -o small && ./small
+ */
+
+#define BB_IMPLEMENTATION
+#include "../bb.h"
+
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef enum { TWO_MALLOCS, CREATE, STACK_INLINE, STACK_INIT } Kind;
+
+static volatile char sink;    // keeps the buffers from being optimized away
+
+// ns per create + append + destroy cycle
+static double cycle(Kind kind, size_t capacity, size_t length) {
+    char src[256];
+    memset(src, 'x', sizeof(src));
+
+    size_t rounds = 0;
+    double start = now(), elapsed;
+    do {
+        for (int r = 0; r < 10000; r++) {
+            if (kind == TWO_MALLOCS) {
+                // what bb_create did for every size before the inline storage
+                BinBuffer* bb = bb_adopt((char*) malloc (capacity), 0, capacity);
+                bb_append(bb, src, length);
+                sink = bb->data[length - 1];
+                bb_destroy(bb);
+            } else if (kind == CREATE) {
+                BinBuffer* bb = bb_create(capacity);
+                bb_append(bb, src, length);
+                sink = bb->data[length - 1];
+                bb_destroy(bb);
+            } else if (kind == STACK_INLINE) {
+                BinBufferInline ibb;
+                BinBuffer* bb = bb_init_inline(&ibb);
+                bb_append(bb, src, length);
+                sink = bb->data[length - 1];
+                bb_deinit(bb);
+            } else {
+                BinBuffer bb;
+                bb_init(&bb);
+                bb_append(&bb, src, length);
+                sink = bb.data[length - 1];
+                bb_deinit(&bb);
+            }
+        }
+        rounds += 10000;
+        elapsed = now() - start;
+    } while (elapsed < 0.3);
+    return elapsed / rounds * 1e9;
+}
+
+int main(void) {
+    // the last row outgrows the inline bytes, so the inline kinds pay for a spill to the heap
+    static const size_t capacities[] = { 16, 64, 32 };
+    static const size_t lengths[] = { 16, 48, 200 };
+
+    // half a second of untimed work, otherwise the first row also pays for clock ramp-up
+    for (double until = now() + 0.5; now() < until;) cycle(TWO_MALLOCS, 64, 48);
+
+    printf("%8s %6s %13s %10s %14s %11s\n", "capacity", "append", "two mallocs", "bb_create", "stack inline",
+           "stack init");
+    for (size_t s = 0; s < sizeof(capacities) / sizeof(capacities[0]); s++) {
+        printf("%8zu %6zu %10.1f ns %7.1f ns %11.1f ns %8.1f ns\n", capacities[s], lengths[s],
+               cycle(TWO_MALLOCS, capacities[s], lengths[s]), cycle(CREATE, capacities[s], lengths[s]),
+               cycle(STACK_INLINE, capacities[s], lengths[s]), cycle(STACK_INIT, capacities[s], lengths[s]));
+    }
+
+    return 0;
+}
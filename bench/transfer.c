@@ -0,0 +1,119 @@
+/* bench/transfer.c - copying a large file with bb_transfer_fd against reading it into a BinBuffer and writing that
+ * out, file to file on tmpfs and on the local disk, and file to a pipe. The source stays in the page cache, so this
+ * measures the copy path rather than the device.
+ *
+ * cc -O2 -D_GNU_SOURCE -I.. transfer.c -o transfer && ./transfer [megabytes] [disk directory]
+ */
+
+#define BB_IMPLEMENTATION
+#include "../bb.h"
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// GB/s copying `in` (from its start) to `out_path`, or to a drained pipe if out_path is NULL; chunk 0 means
+// bb_transfer_fd, otherwise bb_read_fd / bb_write_fd through a `chunk`-byte BinBuffer
+static double copy(const char* in_path, const char* out_path, size_t total, size_t chunk) {
+    double best = 0;
+    BinBuffer* bb = chunk ? bb_create(chunk) : NULL;
+    for (int r = 0; r < 3; r++) {
+        int in = open(in_path, O_RDONLY);
+        int out;
+        pid_t drain = -1;
+        if (out_path) {
+            out = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        } else {
+            int fds[2];
+            if (pipe(fds) != 0) exit(1);
+            drain = fork();
+            if (drain == 0) {
+                close(fds[1]);
+                char sink[65536];
+                while (read(fds[0], sink, sizeof(sink)) > 0) {}
+                _exit(0);
+            }
+            close(fds[0]);
+            out = fds[1];
+        }
+        if (in < 0 || out < 0) {
+            perror("open");
+            exit(1);
+        }
+
+        double start = now();
+        size_t done = 0;
+        if (chunk == 0) {
+            ssize_t n = bb_transfer_fd(out, in, total);
+            if (n > 0) done = (size_t) n;
+        } else {
+            for (;;) {
+                bb_clear(bb);
+                ssize_t n = bb_read_fd(bb, in, chunk);
+                if (n <= 0 || !bb_write_fd(bb, out)) break;
+                done += (size_t) n;
+            }
+        }
+        double elapsed = now() - start;
+        if (done != total) {
+            fprintf(stderr, "copied %zu of %zu bytes\n", done, total);
+            exit(1);
+        }
+
+        close(in);
+        close(out);
+        if (drain > 0) waitpid(drain, NULL, 0);
+        if (out_path) unlink(out_path);
+        if (total / elapsed / 1e9 > best) best = total / elapsed / 1e9;
+    }
+    bb_destroy(bb);
+    return best;
+}
+
+int main(int argc, char** argv) {
+    size_t total = (size_t)(argc > 1 ? atoi(argv[1]) : 512) << 20;
+    const char* disk = argc > 2 ? argv[2] : ".";
+
+    char disk_in[4096], disk_out[4096];
+    snprintf(disk_in, sizeof(disk_in), "%s/bb-transfer-in", disk);
+    snprintf(disk_out, sizeof(disk_out), "%s/bb-transfer-out", disk);
+    const char* ins[] = { "/dev/shm/bb-transfer-in", disk_in, disk_in };
+    const char* outs[] = { "/dev/shm/bb-transfer-out", disk_out, NULL };
+    const char* targets[] = { "tmpfs file", "disk file", "pipe" };
+
+    // both sources written once up front; reading them back right away leaves them in the page cache
+    BinBuffer* block = bb_create_large((size_t) 1 << 20, false);
+    memset(bb_claim(block, (size_t) 1 << 20), 'x', (size_t) 1 << 20);
+    for (int i = 0; i < 2; i++) {
+        int fd = open(ins[i], O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        for (size_t done = 0; done < total; done += block->length) {
+            if (fd < 0 || !bb_write_fd(block, fd)) {
+                perror(ins[i]);
+                return 1;
+            }
+        }
+        close(fd);
+    }
+    bb_destroy(block);
+
+    // half a second of untimed work, otherwise the first row also pays for clock ramp-up
+    for (double until = now() + 0.5; now() < until;) copy(ins[0], NULL, total, 65536);
+
+    printf("%zu MiB, GB/s\n", total >> 20);
+    printf("%-11s %14s %14s %14s\n", "target", "bb_transfer_fd", "BinBuffer 64K", "BinBuffer 1M");
+    for (int t = 0; t < 3; t++) {
+        printf("%-11s %14.2f %14.2f %14.2f\n", targets[t], copy(ins[t], outs[t], total, 0),
+               copy(ins[t], outs[t], total, (size_t) 64 << 10), copy(ins[t], outs[t], total, (size_t) 1 << 20));
+        fflush(stdout);
+    }
+
+    unlink(ins[0]);
+    unlink(ins[1]);
+    return 0;
+}
@@ -0,0 +1,144 @@
+/* bench/writev.c - writing many small BinBuffers to a pipe and to a tmpfs file: copy out and write each one, one
+ * bb_write_fd each, bb_writev_fd over all of them, and cbb_write_fd over a ChunkedBinBuffer built from them.
+ * Write syscalls are counted from /proc/self/io.
+ *
+ * cc -O2 -D_GNU_SOURCE -I.. writev.c -o writev && ./writev [thousand buffers]
+ */
+
+#define BB_IMPLEMENTATION
+#include "../bb.h"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <sys/wait.h>
+#include <time.h>
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t write_syscalls(void) {
+    FILE* f = fopen("/proc/self/io", "r");
+    char line[128];
+    uint64_t count = 0;
+    while (f && fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "syscw: %" SCNu64, &count) == 1) break;
+    }
+    if (f) fclose(f);
+    return count;
+}
+
+typedef enum { COLLECT, EACH, WRITEV, CHUNKED } Method;
+
+static const char* names[] = { "bb_collect + write", "bb_write_fd each", "bb_writev_fd", "cbb_write_fd" };
+
+static bool write_all(Method method, BinBuffer** bbs, size_t count, int fd, size_t* copied) {
+    *copied = 0;
+    if (method == COLLECT) {
+        // what bb_collect + write costs, without destroying the inputs
+        for (size_t i = 0; i < count; i++) {
+            char* data = (char*) malloc (bbs[i]->length);
+            memcpy(data, bbs[i]->data, bbs[i]->length);
+            *copied += bbs[i]->length;
+            for (size_t done = 0; done < bbs[i]->length;) {
+                ssize_t n = write(fd, data + done, bbs[i]->length - done);
+                if (n < 0 && errno != EINTR) return false;
+                if (n > 0) done += (size_t) n;
+            }
+            free(data);
+        }
+    } else if (method == EACH) {
+        for (size_t i = 0; i < count; i++) {
+            if (!bb_write_fd(bbs[i], fd)) return false;
+        }
+    } else if (method == WRITEV) {
+        return bb_writev_fd(bbs, count, fd);
+    } else {
+        ChunkedBinBuffer* cbb = cbb_create(65536);
+        for (size_t i = 0; i < count; i++) cbb_append(cbb, bbs[i]->data, bbs[i]->length);
+        *copied = cbb->length;
+        bool ok = cbb_write_fd(cbb, fd);
+        cbb_destroy(cbb);
+        return ok;
+    }
+    return true;
+}
+
+// one row: MB/s, write syscalls and bytes copied for a single pass over all buffers, best of three
+static void row(const char* target, Method method, BinBuffer** bbs, size_t count, size_t total) {
+    double best = 0;
+    uint64_t syscalls = 0;
+    size_t copied = 0;
+    for (int r = 0; r < 3; r++) {
+        int fd;
+        pid_t drain = -1;
+        if (strcmp(target, "pipe") == 0) {
+            int fds[2];
+            if (pipe(fds) != 0) exit(1);
+            drain = fork();
+            if (drain == 0) {
+                close(fds[1]);
+                char sink[65536];
+                while (read(fds[0], sink, sizeof(sink)) > 0) {}
+                _exit(0);
+            }
+            close(fds[0]);
+            fd = fds[1];
+        } else {
+            fd = open("/dev/shm/bb-writev-bench", O_WRONLY | O_CREAT | O_TRUNC, 0600);
+            if (fd < 0) exit(1);
+        }
+
+        uint64_t before = write_syscalls();
+        double start = now();
+        if (!write_all(method, bbs, count, fd, &copied)) {
+            perror("write");
+            exit(1);
+        }
+        double elapsed = now() - start;
+        syscalls = write_syscalls() - before;
+
+        close(fd);
+        if (drain > 0) waitpid(drain, NULL, 0);
+        if (total / elapsed / 1e6 > best) best = total / elapsed / 1e6;
+    }
+    unlink("/dev/shm/bb-writev-bench");
+
+    printf("%-6s %-20s %10.0f %10" PRIu64 " %11.1f\n", target, names[method], best, syscalls, copied / 1048576.0);
+}
+
+int main(int argc, char** argv) {
+    size_t count = (size_t)(argc > 1 ? atoi(argv[1]) : 100) * 1000;
+    static const size_t sizes[] = { 64, 1024 };
+    static const char* targets[] = { "pipe", "tmpfs" };
+
+    BinBuffer** bbs = (BinBuffer**) malloc (count * sizeof(BinBuffer*));
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for (size_t i = 0; i < count; i++) {
+            bbs[i] = bb_create(sizes[s]);
+            memset(bb_claim(bbs[i], sizes[s]), 'x', sizes[s]);
+        }
+
+        // half a second of untimed work, otherwise the first row also pays for clock ramp-up
+        if (s == 0) {
+            size_t copied;
+            int fd = open("/dev/null", O_WRONLY);
+            for (double until = now() + 0.5; now() < until;) write_all(COLLECT, bbs, count / 10, fd, &copied);
+            close(fd);
+        }
+
+        printf("%zu buffers of %zu bytes\n", count, sizes[s]);
+        printf("%-6s %-20s %10s %10s %11s\n", "target", "method", "MB/s", "syscalls", "copied MiB");
+        for (size_t t = 0; t < sizeof(targets) / sizeof(targets[0]); t++) {
+            for (int m = COLLECT; m <= CHUNKED; m++) row(targets[t], (Method) m, bbs, count, count * sizes[s]);
+        }
+        printf("\n");
+
+        for (size_t i = 0; i < count; i++) bb_destroy(bbs[i]);
+    }
+
+    free(bbs);
+    return 0;
+}
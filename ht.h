@@ -9,6 +9,42 @@
  * compatible with the signature `uint64_t name(const char*)` and assigning it to hashFunc member of Your HashTable
  * struct, or using one of other provided hashing functions:
  *  - prhf - polynomial rolling hash function
+ *
+ * Tables made with `ht_create_mode` can use a different layout behind the same get/set/remove/iterate API:
+ *  - HT_LINEAR - the default described above
+ *  - HT_CUCKOO - bucketized cuckoo hashing: every key lives in one of two HT_CUCKOO_WAYS-wide, cache-line sized
+ *    buckets, so a lookup (hit or miss) never looks further than two buckets, even at 90%+ load. A one-byte tag
+ *    per slot, kept in the bucket's own cache line, filters out most strcmp calls. Change hashFunc only while
+ *    the table is empty. Growth forced by failed placements stops at HT_GROWTH_LIMIT slots per entry; past that
+ *    ht_set fails (returns NULL), which only happens with a hashFunc that maps many keys to the same few values.
+ *  - HT_HOPSCOTCH - hopscotch hashing: each home slot keeps a bitmap of which of the next HT_HOPSCOTCH_RANGE
+ *    slots hold its keys, so a lookup inspects only the tag bytes of those neighbours (and the entry whose tag
+ *    matches); inserts hop entries backwards to keep every key inside its home neighbourhood. Same hashFunc
+ *    and HT_GROWTH_LIMIT caveats as HT_CUCKOO.
+ *  - HT_CONCURRENT - the HT_CUCKOO layout made safe for many threads calling ht_get/ht_set/ht_remove at once.
+ *    Every bucket has a version counter that doubles as its writer lock: writers lock the key's two buckets and
+ *    bump their versions, readers never write shared memory in the table - they probe optimistically and retry
+ *    if a version moved underneath them. Removed keys, replaced values (destroyFunc) and outgrown bucket arrays
+ *    may still be seen by a reader, so they are retired and freed by a later write once every operation that
+ *    started before their removal has finished (epoch-based: each call counts itself in a per-thread cache line,
+ *    no registration needed). A value from ht_get is therefore only safe to use after the call returns while
+ *    the thread holds an ht_pin; values returned by ht_remove can be handed to ht_retire to be freed the same
+ *    way. ht_reclaim frees whatever is left at once and, like ht_iterator and ht_destroy, must only be called
+ *    while no other thread uses the table.
+ *    Growing holds every bucket while the entries are rehashed, so all other calls wait for the whole rebuild -
+ *    size the table up front where that pause matters. Needs GCC or Clang atomics (HT_CONCURRENT_SUPPORTED).
+ *  - HT_COMPACT - linear probing over 8-byte slots (32-bit arena offset + 32-bit hash) instead of 16-byte
+ *    entries, filled to 90% before growing. Each key is stored once, next to its value pointer, in a
+ *    table-owned arena rather than its own strdup allocation; removed records are reclaimed by repacking the
+ *    arena. Keys handed out by iteration point into the arena and are valid until the next ht_set/ht_remove.
+ *    Arena offsets count 8-byte units, so keys plus value pointers are limited to 32 GiB per table.
+ *
+ * Tables that are rebuilt wholesale rather than edited (configs, routing maps) can be shared through a
+ * HashTableRcu instead: a writer fills a fresh table of any mode off to the side and ht_rcu_publish swaps it in,
+ * readers do `ht_get(ht_rcu_current(rcu), key)` - one atomic load on top of a plain lookup. Each reader thread
+ * registers once and calls ht_rcu_quiescent at points where it holds nothing from the table (between requests);
+ * a replaced table is destroyed once every registered reader has passed such a point (ht_rcu_collect, or
+ * ht_rcu_synchronize to wait for it). Published tables must not be modified any more.
  * 
  * Sample usage:
  * ```c
@@ -67,6 +103,56 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+// slots per cuckoo bucket - 3 entries plus their tags fill one 64-byte cache line, 7 fill an adjacent pair
+#ifndef HT_CUCKOO_WAYS
+#define HT_CUCKOO_WAYS 3
+#endif
+#if HT_CUCKOO_WAYS != 3 && HT_CUCKOO_WAYS != 7
+#error "HT_CUCKOO_WAYS must be 3 or 7"
+#endif
+#define _HT_BUCKET_BYTES (HT_CUCKOO_WAYS == 3 ? 64 : 128)
+
+// placement-driven growth (cuckoo, hopscotch) never takes a table past this many slots per entry, so a hashFunc
+// that keeps colliding makes ht_set fail instead of doubling the table until memory runs out
+#ifndef HT_GROWTH_LIMIT
+#define HT_GROWTH_LIMIT 8
+#endif
+
+// how many buckets an insert may explore looking for a displacement path before the table grows
+#ifndef HT_CUCKOO_SEARCH
+#define HT_CUCKOO_SEARCH 256
+#endif
+
+// HT_CONCURRENT: cache lines of per-thread operation counters; threads beyond this many share lines
+#ifndef HT_CONCURRENT_STRIPES
+#define HT_CONCURRENT_STRIPES 16
+#endif
+
+// HT_CONCURRENT: retirements between attempts to free retired memory
+#ifndef HT_CONCURRENT_COLLECT
+#define HT_CONCURRENT_COLLECT 64
+#endif
+
+// neighbourhood size of a hopscotch home slot; its bitmap is a uint64_t. A lookup only reads the one-byte tags
+// of the slots its bitmap names, so 64 slots of tags cover one or two cache lines. Below 64 the first failed
+// displacement, and with it growth, comes early: 32 gives up at ~0.85 load on a million slots, 8 at ~0.45
+#ifndef HT_HOPSCOTCH_RANGE
+#define HT_HOPSCOTCH_RANGE 64
+#endif
+#if HT_HOPSCOTCH_RANGE < 2 || HT_HOPSCOTCH_RANGE > 64
+#error "HT_HOPSCOTCH_RANGE must be between 2 and 64"
+#endif
+
+// how far past the home slot an insert may look for a free slot to hop back before the table grows; near 0.9 load
+// the nearest free slot is often several hundred slots away, and 512 stops a million-slot table at ~0.87
+#ifndef HT_HOPSCOTCH_PROBE
+#define HT_HOPSCOTCH_PROBE 2048
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define HT_CONCURRENT_SUPPORTED
+#endif
+
 typedef void (*DestroyFunc)(void*);
 typedef uint64_t (*HashFunc)(const char*);
 
@@ -75,14 +161,100 @@ typedef struct {
     void* value;
 } HashTableEntry;
 
+typedef enum {
+    HT_LINEAR,
+    HT_CUCKOO,
+    HT_HOPSCOTCH,
+    HT_CONCURRENT,
+    HT_COMPACT,
+} HashTableMode;
+
+typedef struct {
+    uint32_t offset;    // record position in the arena in 8-byte units, plus one; 0 = empty slot
+    uint32_t hash;      // 32 bits of the key's hash: home slot, probe filter, and rehashing without the key
+} HashTableCompactSlot;
+
+// HT_CUCKOO and HT_CONCURRENT bucket: a probe reads tags and entries from the same cache line (or aligned pair)
+typedef struct {
+    uint32_t version;                       // HT_CONCURRENT: odd while a writer holds the bucket
+    uint8_t tags[HT_CUCKOO_WAYS];           // one byte of each key's hash, 0 = empty slot
+    uint8_t _pad[_HT_BUCKET_BYTES - sizeof(uint32_t) - HT_CUCKOO_WAYS * (1 + sizeof(HashTableEntry))];
+    HashTableEntry entries[HT_CUCKOO_WAYS];
+} HashTableBucket;
+
+// HT_CONCURRENT bucket array, replaced as a whole when the table grows
+typedef struct _HashTableArrays {
+    HashTableBucket* buckets;
+    uint64_t capacity;
+} _HashTableArrays;
+
+// something a concurrent reader may still be looking at, destroyed once no operation from before its removal is left
+typedef struct _HashTableRetired {
+    struct _HashTableRetired* next;
+    void* ptr;
+    DestroyFunc destroy;
+} _HashTableRetired;
+
+// HT_CONCURRENT: operations in progress per epoch parity, for the threads mapped to this line
+typedef struct {
+    uint64_t active[2];
+    uint8_t _pad[64 - 2 * sizeof(uint64_t)];
+} _HashTableStripe;
+
 typedef struct {
     HashTableEntry* entries;
     uint64_t capacity;
     uint64_t length;
     DestroyFunc destroyFunc;
     HashFunc hashFunc;
+
+    HashTableMode mode;
+    uint8_t* tags;  // HT_HOPSCOTCH: one byte of the key's hash per slot, 0 = empty
+    uint64_t* hops; // HT_HOPSCOTCH: per home slot, bit i set = slot home+i holds one of its keys
+
+    // HT_CUCKOO, HT_CONCURRENT: entries is NULL, capacity counts slots (HT_CUCKOO_WAYS per bucket)
+    HashTableBucket* buckets;
+
+    // HT_CONCURRENT: buckets/capacity above mirror _arrays for iteration and destruction
+    _HashTableArrays* _arrays;
+    _HashTableRetired* _retired;    // retired since the last epoch flip
+    _HashTableRetired* _waiting;    // retired before it, freed once operations of the previous epoch drain
+    _HashTableStripe* _stripes;
+    uint64_t _epoch;
+    uint64_t _pending;  // retirements since the last collection attempt
+    uint32_t _lock;     // serializes cuckoo displacement, growth and collection
+
+    // HT_COMPACT: entries is NULL, capacity counts slots; records are a value pointer followed by the key
+    HashTableCompactSlot* slots;
+    char* arena;
+    uint64_t arenaLength;
+    uint64_t arenaCapacity;
+    uint64_t arenaGarbage;  // bytes of removed records, reclaimed by repacking
 } HashTable;
 
+// a replaced snapshot waiting for readers to move past it
+typedef struct _HashTableRcuRetired {
+    struct _HashTableRcuRetired* next;
+    HashTable* table;
+    uint64_t epoch;     // reclaimable once every active reader has announced at least this epoch
+} _HashTableRcuRetired;
+
+typedef struct {
+    HashTable* _current;
+    uint64_t _epoch;
+    struct HashTableRcuReader* _readers;
+    _HashTableRcuRetired* _retired;
+    uint32_t _lock;     // serializes publishers and collection
+} HashTableRcu;
+
+// one per reader thread, on its own cache line so that quiescent announcements don't contend
+typedef struct HashTableRcuReader {
+    uint64_t _epoch;
+    uint32_t _active;
+    HashTableRcu* _rcu;
+    struct HashTableRcuReader* _next;
+} HashTableRcuReader;
+
 typedef struct {
     const char* key;
     void* value;
@@ -91,7 +263,13 @@ typedef struct {
     uint64_t _index;
 } HashTableIterator;
 
+// HT_CONCURRENT: held between ht_pin and ht_unpin
+typedef struct {
+    uint64_t* _active;
+} HashTablePin;
+
 HashTable* ht_create(uint64_t size, DestroyFunc destroyFunc);
+HashTable* ht_create_mode(uint64_t size, DestroyFunc destroyFunc, HashTableMode mode);
 void ht_destroy(HashTable* ht);
 
 void* ht_get(HashTable* ht, const char* key);
@@ -103,10 +281,28 @@ const char* ht_set(HashTable* ht, const char* key, void* value);
 } while(0)
 size_t ht_length(HashTable* ht);
 void* ht_remove(HashTable* ht, const char* key);
+void ht_reclaim(HashTable* ht);
 
 HashTableIterator* ht_iterator(HashTable* ht);
 bool ht_next(HashTableIterator* it);
 
+#ifdef HT_CONCURRENT_SUPPORTED
+HashTablePin ht_pin(HashTable* ht);
+void ht_unpin(HashTablePin pin);
+bool ht_retire(HashTable* ht, void* ptr, DestroyFunc destroy);
+
+HashTableRcu* ht_rcu_create(HashTable* initial);
+void ht_rcu_destroy(HashTableRcu* rcu);
+HashTable* ht_rcu_current(HashTableRcu* rcu);
+bool ht_rcu_publish(HashTableRcu* rcu, HashTable* fresh);
+size_t ht_rcu_collect(HashTableRcu* rcu);
+void ht_rcu_synchronize(HashTableRcu* rcu);
+
+HashTableRcuReader* ht_rcu_register(HashTableRcu* rcu);
+void ht_rcu_unregister(HashTableRcuReader* reader);
+void ht_rcu_quiescent(HashTableRcuReader* reader);
+#endif
+
 #if defined(HT_IMPLEMENTATION) || defined(DEBUG)
 
 uint64_t fnv1a(const char* key) {
@@ -133,28 +329,190 @@ uint64_t prhf(const char* key) {
     return hash_value;
 }
 
-HashTable* ht_create(uint64_t size, DestroyFunc destroyFunc) {
+// splitmix64 finalizer - stretches one hashFunc result into a second, independent-looking hash
+static uint64_t _ht_mix(uint64_t hash) {
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+// slot tag taken from a mixed hash; never 0, which marks an empty slot
+static uint8_t _ht_tag(uint64_t mixed) {
+    uint8_t tag = (uint8_t)(mixed >> 56);
+    return tag != 0 ? tag : 1;
+}
+
+// start loading a bucket that is scanned right after the current one
+#if defined(__GNUC__) || defined(__clang__)
+#define _ht_prefetch(p) __builtin_prefetch(p)
+#else
+#define _ht_prefetch(p) ((void) 0)
+#endif
+
+// small tables may always grow, bigger ones only while they stay within HT_GROWTH_LIMIT slots per entry
+static bool _ht_growth_allowed(uint64_t length, uint64_t capacity) {
+    return capacity <= 256 || capacity / HT_GROWTH_LIMIT <= length + 1;
+}
+
+// zeroed and cache-line aligned, NULL on failure
+static HashTableBucket* _ht_cuckoo_alloc(uint64_t count) {
+    size_t bytes = count * sizeof(HashTableBucket);
+
+    HashTableBucket* buckets = (HashTableBucket*) aligned_alloc (64, bytes);
+    if (buckets != NULL) {
+        memset(buckets, 0, bytes);
+    }
+    return buckets;
+}
+
+// slot numbers run bucket by bucket, HT_CUCKOO_WAYS to a bucket
+static HashTableEntry* _ht_cuckoo_entry(HashTableBucket* buckets, uint64_t slot) {
+    return &buckets[slot / HT_CUCKOO_WAYS].entries[slot % HT_CUCKOO_WAYS];
+}
+
+static uint8_t* _ht_cuckoo_tag(HashTableBucket* buckets, uint64_t slot) {
+    return &buckets[slot / HT_CUCKOO_WAYS].tags[slot % HT_CUCKOO_WAYS];
+}
+
+static bool _ht_hop_alloc(uint64_t capacity, HashTableEntry** entries, uint8_t** tags, uint64_t** hops) {
+    *entries = (HashTableEntry*) calloc (capacity, sizeof(HashTableEntry));
+    *tags = (uint8_t*) calloc (capacity, sizeof(uint8_t));
+    *hops = (uint64_t*) calloc (capacity, sizeof(uint64_t));
+    if (*entries == NULL || *tags == NULL || *hops == NULL) {
+        free(*entries);
+        free(*tags);
+        free(*hops);
+        return false;
+    }
+
+    return true;
+}
+
+HashTable* ht_create_mode(uint64_t size, DestroyFunc destroyFunc, HashTableMode mode) {
     HashTable* ht = (HashTable*) malloc (sizeof(HashTable));
     if (ht == NULL) {
         return NULL;
     }
 
-    ht->entries = (HashTableEntry*) calloc (size, sizeof(HashTableEntry));
-    if (ht->entries == NULL) {
+    ht->entries = NULL;
+    ht->tags = NULL;
+    ht->hops = NULL;
+    ht->buckets = NULL;
+    ht->_arrays = NULL;
+    ht->_retired = NULL;
+    ht->_waiting = NULL;
+    ht->_stripes = NULL;
+    ht->_epoch = 1;
+    ht->_pending = 0;
+    ht->_lock = 0;
+    ht->slots = NULL;
+    ht->arena = NULL;
+    ht->arenaLength = ht->arenaCapacity = ht->arenaGarbage = 0;
+    if (mode == HT_COMPACT) {
+        uint64_t capacity = 8;
+        while (capacity < size) capacity *= 2;
+
+        ht->entries = NULL;
+        ht->slots = (HashTableCompactSlot*) calloc (capacity, sizeof(HashTableCompactSlot));
+        if (ht->slots == NULL) {
+            free(ht);
+            return NULL;
+        }
+        size = capacity;
+    } else if (mode == HT_CONCURRENT) {
+#ifdef HT_CONCURRENT_SUPPORTED
+        uint64_t buckets = 2;
+        while (buckets * HT_CUCKOO_WAYS < size) buckets *= 2;
+
+        ht->_arrays = (_HashTableArrays*) malloc (sizeof(_HashTableArrays));
+        if (ht->_arrays == NULL) {
+            free(ht);
+            return NULL;
+        }
+
+        ht->buckets = _ht_cuckoo_alloc(buckets);
+        ht->_stripes = (_HashTableStripe*) aligned_alloc (64, HT_CONCURRENT_STRIPES * sizeof(_HashTableStripe));
+        if (ht->buckets == NULL || ht->_stripes == NULL) {
+            free(ht->buckets);
+            free(ht->_stripes);
+            free(ht->_arrays);
+            free(ht);
+            return NULL;
+        }
+        memset(ht->_stripes, 0, HT_CONCURRENT_STRIPES * sizeof(_HashTableStripe));
+
+        size = buckets * HT_CUCKOO_WAYS;
+        ht->_arrays->buckets = ht->buckets;
+        ht->_arrays->capacity = size;
+#else
         free(ht);
         return NULL;
+#endif
+    } else if (mode == HT_HOPSCOTCH) {
+        uint64_t capacity = 2 * HT_HOPSCOTCH_RANGE;
+        while (capacity < size) capacity *= 2;
+
+        if (!_ht_hop_alloc(capacity, &ht->entries, &ht->tags, &ht->hops)) {
+            free(ht);
+            return NULL;
+        }
+        size = capacity;
+    } else if (mode == HT_CUCKOO) {
+        uint64_t buckets = 2;
+        while (buckets * HT_CUCKOO_WAYS < size) buckets *= 2;
+
+        ht->buckets = _ht_cuckoo_alloc(buckets);
+        if (ht->buckets == NULL) {
+            free(ht);
+            return NULL;
+        }
+        size = buckets * HT_CUCKOO_WAYS;
+    } else {
+        ht->entries = (HashTableEntry*) calloc (size, sizeof(HashTableEntry));
+        if (ht->entries == NULL) {
+            free(ht);
+            return NULL;
+        }
     }
 
     ht->capacity = size;
     ht->length = 0;
     ht->destroyFunc = destroyFunc;
     ht->hashFunc = fnv1a;
+    ht->mode = mode;
 
     return ht;
 }
 
+HashTable* ht_create(uint64_t size, DestroyFunc destroyFunc) {
+    return ht_create_mode(size, destroyFunc, HT_LINEAR);
+}
+
 void ht_destroy(HashTable* ht) {
-    for (uint64_t i = 0; i < ht->capacity; i++) {
+    ht_reclaim(ht);
+    free(ht->_arrays);
+    free(ht->_stripes);
+
+    for (uint64_t i = 0; ht->buckets != NULL && i < ht->capacity; i++) {
+        HashTableEntry* entry = _ht_cuckoo_entry(ht->buckets, i);
+        if (entry->key != NULL) {
+            free(entry->key);
+            if (ht->destroyFunc != NULL) {
+                ht->destroyFunc(entry->value);
+            }
+        }
+    }
+
+    for (uint64_t i = 0; ht->slots != NULL && i < ht->capacity; i++) {
+        if (ht->slots[i].offset != 0 && ht->destroyFunc != NULL) {
+            ht->destroyFunc(*(void**) (ht->arena + (uint64_t)(ht->slots[i].offset - 1) * 8));
+        }
+    }
+
+    for (uint64_t i = 0; ht->entries != NULL && i < ht->capacity; i++) {
         if (ht->entries[i].key != NULL) {
             free((void*) ht->entries[i].key);
             if (ht->destroyFunc != NULL) {
@@ -164,141 +522,1418 @@ void ht_destroy(HashTable* ht) {
     }
 
     free(ht->entries);
+    free(ht->tags);
+    free(ht->hops);
+    free(ht->buckets);
+    free(ht->slots);
+    free(ht->arena);
     free(ht);
 }
 
 size_t ht_length(HashTable* ht) {
+#ifdef HT_CONCURRENT_SUPPORTED
+    if (ht->mode == HT_CONCURRENT) {
+        return __atomic_load_n(&ht->length, __ATOMIC_RELAXED);
+    }
+#endif
     return ht->length;
 }
 
-void* ht_get(HashTable* ht, const char* key) {
+static void _ht_free_retired(_HashTableRetired* node) {
+    while (node != NULL) {
+        _HashTableRetired* next = node->next;
+        if (node->destroy != NULL) {
+            node->destroy(node->ptr);
+        }
+        free(node);
+        node = next;
+    }
+}
+
+void ht_reclaim(HashTable* ht) {
+    _ht_free_retired(ht->_waiting);
+    _ht_free_retired(ht->_retired);
+    ht->_waiting = NULL;
+    ht->_retired = NULL;
+    ht->_pending = 0;
+}
+
+// the two candidate buckets and the tag of a key; the buckets always differ
+static void _ht_cuckoo_home(HashTable* ht, uint64_t capacity, const char* key, uint64_t* first, uint64_t* second, uint8_t* tag) {
+    uint64_t mask = capacity / HT_CUCKOO_WAYS - 1;
     uint64_t hash = ht->hashFunc(key);
-    uint64_t index = (size_t)(hash & (uint64_t)(ht->capacity - 1));
+    uint64_t mixed = _ht_mix(hash);
 
-    while (ht->entries[index].key != NULL) {
-        if (strcmp(ht->entries[index].key, key) == 0) {
-            return ht->entries[index].value;
-        }
+    *first = hash & mask;
+    *second = mixed & mask;
+    if (*second == *first) *second = *first ^ 1;
 
-        index = (index + 1) % ht->capacity;
+    *tag = _ht_tag(mixed);
+}
+
+static bool _ht_cuckoo_find(HashTable* ht, const char* key, uint64_t* slot) {
+    uint64_t buckets[2];
+    uint8_t tag;
+    _ht_cuckoo_home(ht, ht->capacity, key, &buckets[0], &buckets[1], &tag);
+    _ht_prefetch(&ht->buckets[buckets[1]]);
+
+    for (int b = 0; b < 2; b++) {
+        HashTableBucket* bucket = &ht->buckets[buckets[b]];
+        for (int i = 0; i < HT_CUCKOO_WAYS; i++) {
+            if (bucket->tags[i] == tag && strcmp(bucket->entries[i].key, key) == 0) {
+                *slot = buckets[b] * HT_CUCKOO_WAYS + i;
+                return true;
+            }
+        }
     }
 
-    return NULL;
+    return false;
 }
 
-int ht_expand(HashTable* ht) {
-    uint64_t newCapacity = ht->capacity * 2;
-    HashTableEntry* newEntries = (HashTableEntry*) calloc (newCapacity, sizeof(HashTableEntry));
-    if (newEntries == NULL) {
-        return 0;
+static bool _ht_cuckoo_free_slot(HashTable* ht, uint64_t bucket, uint64_t* slot) {
+    for (int i = 0; i < HT_CUCKOO_WAYS; i++) {
+        if (ht->buckets[bucket].tags[i] == 0) {
+            *slot = bucket * HT_CUCKOO_WAYS + i;
+            return true;
+        }
     }
 
-    for (uint64_t i = 0; i < ht->capacity; i++) {
-        if (ht->entries[i].key != NULL) {
-            uint64_t hash = ht->hashFunc(ht->entries[i].key);
-            uint64_t index = (size_t)(hash & (uint64_t)(newCapacity - 1));
+    return false;
+}
 
-            while (newEntries[index].key != NULL) {
-                index = (index + 1) % newCapacity;
+// puts an already owned key into the table, displacing residents along the shortest path found by a
+// breadth-first search over alternate buckets; false when no path exists within HT_CUCKOO_SEARCH buckets
+static bool _ht_cuckoo_place(HashTable* ht, char* key, void* value) {
+    uint64_t first, second, slot;
+    uint8_t tag;
+    _ht_cuckoo_home(ht, ht->capacity, key, &first, &second, &tag);
+
+    if (!_ht_cuckoo_free_slot(ht, first, &slot) && !_ht_cuckoo_free_slot(ht, second, &slot)) {
+        struct {
+            uint64_t bucket;
+            int parent;         // queue index of the bucket we came from, -1 for first/second
+            int parent_slot;    // slot in that bucket whose entry would move here
+        } queue[HT_CUCKOO_SEARCH];
+
+        queue[0].bucket = first;
+        queue[1].bucket = second;
+        queue[0].parent = queue[1].parent = -1;
+        queue[0].parent_slot = queue[1].parent_slot = 0;
+        int count = 2;
+        bool found = false;
+
+        for (int head = 0; head < count && !found; head++) {
+            for (int i = 0; i < HT_CUCKOO_WAYS && !found; i++) {
+                uint64_t from = queue[head].bucket * HT_CUCKOO_WAYS + i;
+                uint64_t alt_first, alt_second, free_slot;
+                uint8_t alt_tag;
+                _ht_cuckoo_home(ht, ht->capacity, _ht_cuckoo_entry(ht->buckets, from)->key, &alt_first, &alt_second, &alt_tag);
+                uint64_t alt = alt_first == queue[head].bucket ? alt_second : alt_first;
+
+                if (_ht_cuckoo_free_slot(ht, alt, &free_slot)) {
+                    // shift every entry on the path one step towards its free end
+                    int node = head;
+                    uint64_t hole = from;
+                    *_ht_cuckoo_entry(ht->buckets, free_slot) = *_ht_cuckoo_entry(ht->buckets, hole);
+                    *_ht_cuckoo_tag(ht->buckets, free_slot) = *_ht_cuckoo_tag(ht->buckets, hole);
+
+                    while (queue[node].parent >= 0) {
+                        uint64_t src = queue[queue[node].parent].bucket * HT_CUCKOO_WAYS + queue[node].parent_slot;
+                        *_ht_cuckoo_entry(ht->buckets, hole) = *_ht_cuckoo_entry(ht->buckets, src);
+                        *_ht_cuckoo_tag(ht->buckets, hole) = *_ht_cuckoo_tag(ht->buckets, src);
+                        hole = src;
+                        node = queue[node].parent;
+                    }
+
+                    slot = hole;
+                    found = true;
+                    break;
+                }
+
+                // a path must not revisit a bucket, or the shifts would overwrite each other
+                bool on_path = false;
+                for (int node = head; node >= 0 && !on_path; node = queue[node].parent) {
+                    on_path = queue[node].bucket == alt;
+                }
+                if (!on_path && count < HT_CUCKOO_SEARCH) {
+                    queue[count].bucket = alt;
+                    queue[count].parent = head;
+                    queue[count].parent_slot = i;
+                    count++;
+                }
             }
+        }
 
-            newEntries[index].key = ht->entries[i].key;
-            newEntries[index].value = ht->entries[i].value;
+        if (!found) {
+            return false;
         }
     }
 
-    free(ht->entries);
-    ht->entries = newEntries;
-    ht->capacity = newCapacity;
+    HashTableEntry* entry = _ht_cuckoo_entry(ht->buckets, slot);
+    entry->key = key;
+    entry->value = value;
+    *_ht_cuckoo_tag(ht->buckets, slot) = tag;
+    return true;
+}
 
-    return 1;
+static bool _ht_cuckoo_grow(HashTable* ht) {
+    HashTableBucket* oldBuckets = ht->buckets;
+    uint64_t oldCapacity = ht->capacity;
+
+    for (uint64_t capacity = oldCapacity * 2; ; capacity *= 2) {
+        ht->buckets = _ht_growth_allowed(ht->length, capacity) ? _ht_cuckoo_alloc(capacity / HT_CUCKOO_WAYS) : NULL;
+        if (ht->buckets == NULL) {
+            ht->buckets = oldBuckets;
+            ht->capacity = oldCapacity;
+            return false;
+        }
+        ht->capacity = capacity;
+
+        bool placed = true;
+        for (uint64_t i = 0; i < oldCapacity && placed; i++) {
+            if (*_ht_cuckoo_tag(oldBuckets, i) != 0) {
+                HashTableEntry* entry = _ht_cuckoo_entry(oldBuckets, i);
+                placed = _ht_cuckoo_place(ht, entry->key, entry->value);
+            }
+        }
+
+        if (placed) {
+            break;
+        }
+
+        // unlucky cycle at this size - try twice as many buckets
+        free(ht->buckets);
+    }
+
+    free(oldBuckets);
+    return true;
 }
 
-const char* ht_set(HashTable* ht, const char* key, void* value) {
-    if (value == NULL) {
-        return NULL;
+static const char* _ht_cuckoo_set(HashTable* ht, const char* key, void* value) {
+    uint64_t slot;
+    if (_ht_cuckoo_find(ht, key, &slot)) {
+        HashTableEntry* entry = _ht_cuckoo_entry(ht->buckets, slot);
+        if (ht->destroyFunc != NULL) {
+            ht->destroyFunc(entry->value);
+        }
+        entry->value = value;
+        return key;
     }
 
-    if (ht->length >= ht->capacity) {
-        if (!ht_expand(ht)) {
+    char* copy = strdup(key);
+    if (copy == NULL) return NULL;
+
+    while (!_ht_cuckoo_place(ht, copy, value)) {
+        if (!_ht_cuckoo_grow(ht)) {
+            free(copy);
             return NULL;
         }
     }
 
-    uint64_t hash = ht->hashFunc(key);
-    uint64_t index = (size_t)(hash & (uint64_t)(ht->capacity - 1));
+    ht->length++;
+    return key;
+}
 
-    while (ht->entries[index].key != NULL) {
-        if (strcmp(ht->entries[index].key, key) == 0) {
-            if (ht->destroyFunc != NULL) {
-                ht->destroyFunc(ht->entries[index].value);
-            }
-            ht->entries[index].value = value;
-            return key;
+static void* _ht_cuckoo_remove(HashTable* ht, const char* key) {
+    uint64_t slot;
+    if (!_ht_cuckoo_find(ht, key, &slot)) {
+        return NULL;
+    }
+
+    HashTableEntry* entry = _ht_cuckoo_entry(ht->buckets, slot);
+    void* value = entry->value;
+    free(entry->key);
+    entry->key = NULL;
+    entry->value = NULL;
+    *_ht_cuckoo_tag(ht->buckets, slot) = 0;
+    ht->length--;
+    return value;
+}
+
+static bool _ht_hop_find(HashTable* ht, const char* key, uint64_t* slot) {
+    uint64_t mask = ht->capacity - 1;
+    uint64_t mixed = _ht_mix(ht->hashFunc(key));
+    uint64_t home = mixed & mask;
+    uint8_t tag = _ht_tag(mixed);
+
+    uint64_t hop = ht->hops[home];
+    for (uint64_t i = 0; hop != 0; i++, hop >>= 1) {
+        uint64_t index = (home + i) & mask;
+        if ((hop & 1) && ht->tags[index] == tag && strcmp(ht->entries[index].key, key) == 0) {
+            *slot = index;
+            return true;
         }
+    }
 
-        index = (index + 1) % ht->capacity;
+    return false;
+}
+
+// puts an already owned key into the table: finds the nearest free slot and, while it is outside the home
+// neighbourhood, swaps it backwards with an entry that may legally move forward into it
+static bool _ht_hop_place(HashTable* ht, char* key, void* value) {
+    uint64_t mask = ht->capacity - 1;
+    // home from the mixed hash: the low bits of fnv1a over similar keys clump, and clumps cost failed hops
+    uint64_t mixed = _ht_mix(ht->hashFunc(key));
+    uint64_t home = mixed & mask;
+
+    uint64_t distance = 0;
+    while (ht->tags[(home + distance) & mask] != 0) {
+        if (++distance >= HT_HOPSCOTCH_PROBE || distance >= ht->capacity) {
+            return false;
+        }
     }
 
-    if (ht->entries[index].key == NULL) {
-        ht->entries[index].key = strdup(key);
-        if (ht->entries[index].key == NULL) return NULL;
-        ht->entries[index].value = value;
-        ht->length++;
-    } else {
-        return NULL;
+    while (distance >= HT_HOPSCOTCH_RANGE) {
+        uint64_t hole = (home + distance) & mask;
+        bool moved = false;
+
+        // farthest candidate home first, so each hop covers as much ground as possible
+        for (uint64_t back = HT_HOPSCOTCH_RANGE - 1; back > 0 && !moved; back--) {
+            uint64_t candidate = (hole - back) & mask;
+            uint64_t hop = ht->hops[candidate];
+
+            for (uint64_t i = 0; i < back; i++) {
+                if (hop & ((uint64_t) 1 << i)) {
+                    uint64_t from = (candidate + i) & mask;
+                    ht->entries[hole] = ht->entries[from];
+                    ht->tags[hole] = ht->tags[from];
+                    ht->hops[candidate] = (hop & ~((uint64_t) 1 << i)) | ((uint64_t) 1 << back);
+
+                    ht->entries[from].key = NULL;
+                    ht->entries[from].value = NULL;
+                    ht->tags[from] = 0;
+                    distance -= back - i;
+                    moved = true;
+                    break;
+                }
+            }
+        }
+
+        if (!moved) {
+            return false;
+        }
     }
 
-    return key;
+    uint64_t index = (home + distance) & mask;
+    ht->entries[index].key = key;
+    ht->entries[index].value = value;
+    ht->tags[index] = _ht_tag(mixed);
+    ht->hops[home] |= (uint64_t) 1 << distance;
+    return true;
 }
 
-void* ht_remove(HashTable* ht, const char* key) {
-    uint64_t hash = ht->hashFunc(key);
-    uint64_t index = (size_t)(hash & (uint64_t)(ht->capacity - 1));
+static bool _ht_hop_grow(HashTable* ht) {
+    HashTableEntry* oldEntries = ht->entries;
+    uint8_t* oldTags = ht->tags;
+    uint64_t* oldHops = ht->hops;
+    uint64_t oldCapacity = ht->capacity;
 
-    while (ht->entries[index].key != NULL) {
-        if (strcmp(ht->entries[index].key, key) == 0) {
-            void* value = ht->entries[index].value;
-            ht->entries[index].key = NULL;
-            ht->entries[index].value = NULL;
-            ht->length--;
-            return value;
+    for (uint64_t capacity = oldCapacity * 2; ; capacity *= 2) {
+        if (!_ht_growth_allowed(ht->length, capacity) ||
+            !_ht_hop_alloc(capacity, &ht->entries, &ht->tags, &ht->hops)) {
+            ht->entries = oldEntries;
+            ht->tags = oldTags;
+            ht->hops = oldHops;
+            ht->capacity = oldCapacity;
+            return false;
         }
+        ht->capacity = capacity;
 
-        index = (index + 1) % ht->capacity;
+        bool placed = true;
+        for (uint64_t i = 0; i < oldCapacity && placed; i++) {
+            if (oldTags[i] != 0) {
+                placed = _ht_hop_place(ht, oldEntries[i].key, oldEntries[i].value);
+            }
+        }
+
+        if (placed) {
+            break;
+        }
+
+        free(ht->entries);
+        free(ht->tags);
+        free(ht->hops);
     }
 
-    return NULL;
+    free(oldEntries);
+    free(oldTags);
+    free(oldHops);
+    return true;
 }
 
-HashTableIterator* ht_iterator(HashTable* ht) {
-    HashTableIterator* it = (HashTableIterator*) malloc (sizeof(HashTableIterator));
-    if (it == NULL) {
-        return NULL;
+static const char* _ht_hop_set(HashTable* ht, const char* key, void* value) {
+    uint64_t slot;
+    if (_ht_hop_find(ht, key, &slot)) {
+        if (ht->destroyFunc != NULL) {
+            ht->destroyFunc(ht->entries[slot].value);
+        }
+        ht->entries[slot].value = value;
+        return key;
     }
 
-    it->key = NULL;
-    it->value = NULL;
-    it->_ht = ht;
-    it->_index = 0;
+    char* copy = strdup(key);
+    if (copy == NULL) return NULL;
 
-    return it;
-}
+    // grow a little before full - the last few percent make free slots far from home and hops long
+    if ((ht->length + 1) * 16 > ht->capacity * 15 && !_ht_hop_grow(ht)) {
+        free(copy);
+        return NULL;
+    }
 
-bool ht_next(HashTableIterator* it) {
-    while (it->_index < it->_ht->capacity) {
-        if (it->_ht->entries[it->_index].key != NULL) {
-            it->key = it->_ht->entries[it->_index].key;
-            it->value = it->_ht->entries[it->_index].value;
-            it->_index++;
-            return true;
+    while (!_ht_hop_place(ht, copy, value)) {
+        if (!_ht_hop_grow(ht)) {
+            free(copy);
+            return NULL;
         }
+    }
 
-        it->_index++;
+    ht->length++;
+    return key;
+}
+
+static void* _ht_hop_remove(HashTable* ht, const char* key) {
+    uint64_t slot;
+    if (!_ht_hop_find(ht, key, &slot)) {
+        return NULL;
     }
 
-    return false;
+    uint64_t mask = ht->capacity - 1;
+    uint64_t home = _ht_mix(ht->hashFunc(key)) & mask;
+    ht->hops[home] &= ~((uint64_t) 1 << ((slot - home) & mask));
+
+    void* value = ht->entries[slot].value;
+    free(ht->entries[slot].key);
+    ht->entries[slot].key = NULL;
+    ht->entries[slot].value = NULL;
+    ht->tags[slot] = 0;
+    ht->length--;
+    return value;
+}
+
+static char* _ht_compact_record(HashTable* ht, uint32_t offset) {
+    return ht->arena + (uint64_t)(offset - 1) * 8;
 }
 
+// value pointer first keeps it 8-byte aligned and on the same cache line as the start of the key
+static uint64_t _ht_compact_record_size(const char* key) {
+    return (sizeof(void*) + strlen(key) + 1 + 7) & ~(uint64_t) 7;
+}
+
+static uint32_t _ht_compact_hash(HashTable* ht, const char* key) {
+    return (uint32_t)(_ht_mix(ht->hashFunc(key)) >> 32);
+}
+
+static bool _ht_compact_find(HashTable* ht, const char* key, uint32_t hash, uint64_t* slot) {
+    uint64_t mask = ht->capacity - 1;
+    for (uint64_t index = hash & mask; ht->slots[index].offset != 0; index = (index + 1) & mask) {
+        if (ht->slots[index].hash == hash &&
+            strcmp(_ht_compact_record(ht, ht->slots[index].offset) + sizeof(void*), key) == 0) {
+            *slot = index;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void _ht_compact_insert_slot(HashTableCompactSlot* slots, uint64_t capacity, HashTableCompactSlot slot) {
+    uint64_t index = slot.hash & (capacity - 1);
+    while (slots[index].offset != 0) {
+        index = (index + 1) & (capacity - 1);
+    }
+    slots[index] = slot;
+}
+
+// the stored hashes are enough to rehash, no key is read
+static bool _ht_compact_grow(HashTable* ht) {
+    uint64_t newCapacity = ht->capacity * 2;
+    HashTableCompactSlot* newSlots = (HashTableCompactSlot*) calloc (newCapacity, sizeof(HashTableCompactSlot));
+    if (newSlots == NULL) {
+        return false;
+    }
+
+    for (uint64_t i = 0; i < ht->capacity; i++) {
+        if (ht->slots[i].offset != 0) {
+            _ht_compact_insert_slot(newSlots, newCapacity, ht->slots[i]);
+        }
+    }
+
+    free(ht->slots);
+    ht->slots = newSlots;
+    ht->capacity = newCapacity;
+    return true;
+}
+
+// copies the live records into a fresh arena and rewrites their offsets
+static bool _ht_compact_repack(HashTable* ht) {
+    uint64_t live = ht->arenaLength - ht->arenaGarbage;
+    char* arena = (char*) malloc (live > 0 ? live : 8);
+    if (arena == NULL) {
+        return false;
+    }
+
+    uint64_t length = 0;
+    for (uint64_t i = 0; i < ht->capacity; i++) {
+        if (ht->slots[i].offset != 0) {
+            char* record = _ht_compact_record(ht, ht->slots[i].offset);
+            uint64_t size = _ht_compact_record_size(record + sizeof(void*));
+            memcpy(arena + length, record, size);
+            ht->slots[i].offset = (uint32_t)(length / 8 + 1);
+            length += size;
+        }
+    }
+
+    free(ht->arena);
+    ht->arena = arena;
+    ht->arenaLength = length;
+    ht->arenaCapacity = live > 0 ? live : 8;
+    ht->arenaGarbage = 0;
+    return true;
+}
+
+// appends a record and returns its slot offset, 0 on failure
+static uint32_t _ht_compact_append(HashTable* ht, const char* key, void* value) {
+    uint64_t size = _ht_compact_record_size(key);
+
+    // offsets are about to overflow - only dropping removed records can help
+    if ((ht->arenaLength + size) / 8 >= UINT32_MAX) {
+        if (ht->arenaGarbage == 0 || !_ht_compact_repack(ht) || (ht->arenaLength + size) / 8 >= UINT32_MAX) {
+            return 0;
+        }
+    }
+
+    // grow by a quarter: doubling would leave up to half the arena unused, more than the slots themselves cost
+    if (ht->arenaLength + size > ht->arenaCapacity) {
+        uint64_t newCapacity = ht->arenaCapacity > 0 ? ht->arenaCapacity + ht->arenaCapacity / 4 : 256;
+        while (newCapacity < ht->arenaLength + size) newCapacity += newCapacity / 4;
+
+        char* arena = (char*) realloc (ht->arena, newCapacity);
+        if (arena == NULL) {
+            return 0;
+        }
+        ht->arena = arena;
+        ht->arenaCapacity = newCapacity;
+    }
+
+    char* record = ht->arena + ht->arenaLength;
+    memcpy(record, &value, sizeof(void*));
+    memcpy(record + sizeof(void*), key, strlen(key) + 1);
+
+    uint32_t offset = (uint32_t)(ht->arenaLength / 8 + 1);
+    ht->arenaLength += size;
+    return offset;
+}
+
+static const char* _ht_compact_set(HashTable* ht, const char* key, void* value) {
+    uint32_t hash = _ht_compact_hash(ht, key);
+    uint64_t slot;
+    if (_ht_compact_find(ht, key, hash, &slot)) {
+        void** stored = (void**) _ht_compact_record(ht, ht->slots[slot].offset);
+        if (ht->destroyFunc != NULL) {
+            ht->destroyFunc(*stored);
+        }
+        *stored = value;
+        return key;
+    }
+
+    // at most 9/10 full: backward-shift deletion leaves no tombstones to lengthen runs, and an 8-byte slot
+    // keeps even a long run within a few cache lines
+    if ((ht->length + 1) * 10 > ht->capacity * 9 && !_ht_compact_grow(ht)) {
+        return NULL;
+    }
+
+    HashTableCompactSlot fresh;
+    fresh.offset = _ht_compact_append(ht, key, value);
+    fresh.hash = hash;
+    if (fresh.offset == 0) {
+        return NULL;
+    }
+
+    _ht_compact_insert_slot(ht->slots, ht->capacity, fresh);
+    ht->length++;
+    return key;
+}
+
+static void* _ht_compact_remove(HashTable* ht, const char* key) {
+    uint64_t hole;
+    if (!_ht_compact_find(ht, key, _ht_compact_hash(ht, key), &hole)) {
+        return NULL;
+    }
+
+    char* record = _ht_compact_record(ht, ht->slots[hole].offset);
+    void* value = *(void**) record;
+    ht->arenaGarbage += _ht_compact_record_size(record + sizeof(void*));
+
+    // backward-shift deletion: pull later members of the probe run into the hole, so no tombstones are needed
+    uint64_t mask = ht->capacity - 1;
+    for (uint64_t index = (hole + 1) & mask; ht->slots[index].offset != 0; index = (index + 1) & mask) {
+        uint64_t home = ht->slots[index].hash & mask;
+        if (((index - home) & mask) >= ((index - hole) & mask)) {
+            ht->slots[hole] = ht->slots[index];
+            hole = index;
+        }
+    }
+    ht->slots[hole].offset = 0;
+    ht->slots[hole].hash = 0;
+    ht->length--;
+
+    // a failed repack only means the garbage stays around a little longer
+    if (ht->arenaGarbage > 4096 && ht->arenaGarbage * 2 > ht->arenaLength) {
+        _ht_compact_repack(ht);
+    }
+
+    return value;
+}
+
+#ifdef HT_CONCURRENT_SUPPORTED
+
+static void _ht_conc_free_arrays(void* ptr) {
+    _HashTableArrays* arrays = (_HashTableArrays*) ptr;
+    free(arrays->buckets);
+    free(arrays);
+}
+
+// tells the core (and a hyperthread sibling) that this is a spin-wait
+static inline void _ht_conc_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__ ("yield");
+#endif
+}
+
+// process-wide, so a thread keeps its stripe across tables
+static __thread uint32_t _ht_conc_thread;
+static uint32_t _ht_conc_threads;
+
+// every HT_CONCURRENT call runs inside one of these: it counts itself under the current epoch's parity in its
+// thread's stripe, and memory retired before an epoch flip is only freed once that parity has drained
+static uint64_t* _ht_conc_enter(HashTable* ht) {
+    if (_ht_conc_thread == 0) {
+        _ht_conc_thread = __atomic_add_fetch(&_ht_conc_threads, 1, __ATOMIC_RELAXED);
+    }
+    _HashTableStripe* stripe = &ht->_stripes[_ht_conc_thread % HT_CONCURRENT_STRIPES];
+
+    for (;;) {
+        uint64_t epoch = __atomic_load_n(&ht->_epoch, __ATOMIC_SEQ_CST);
+        uint64_t* active = &stripe->active[epoch & 1];
+        __atomic_fetch_add(active, 1, __ATOMIC_SEQ_CST);
+
+        // counted under the parity of an epoch that already ended - a collection may have missed us
+        if (__atomic_load_n(&ht->_epoch, __ATOMIC_SEQ_CST) == epoch) {
+            return active;
+        }
+        __atomic_fetch_sub(active, 1, __ATOMIC_RELEASE);
+    }
+}
+
+static void _ht_conc_exit(uint64_t* active) {
+    __atomic_fetch_sub(active, 1, __ATOMIC_RELEASE);
+}
+
+// lock-free push; node was allocated up front so that retiring can't fail halfway through a write
+static void _ht_conc_retire(HashTable* ht, _HashTableRetired* node, void* ptr, DestroyFunc destroy) {
+    node->ptr = ptr;
+    node->destroy = destroy;
+    node->next = __atomic_load_n(&ht->_retired, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&ht->_retired, &node->next, node, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    __atomic_fetch_add(&ht->_pending, 1, __ATOMIC_RELAXED);
+}
+
+// takes a bucket's version from even to odd; false if the arrays were replaced while waiting (growth keeps
+// every bucket of the old arrays locked forever, sending writers and readers to the new ones)
+static bool _ht_conc_lock(HashTable* ht, _HashTableArrays* arrays, uint64_t bucket) {
+    uint32_t* version = &arrays->buckets[bucket].version;
+    for (;;) {
+        uint32_t current = __atomic_load_n(version, __ATOMIC_RELAXED);
+        if ((current & 1) == 0 &&
+            __atomic_compare_exchange_n(version, &current, current + 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            return true;
+        }
+
+        if (__atomic_load_n(&ht->_arrays, __ATOMIC_ACQUIRE) != arrays) {
+            return false;
+        }
+        _ht_conc_pause();
+    }
+}
+
+static void _ht_conc_unlock(_HashTableArrays* arrays, uint64_t bucket) {
+    __atomic_fetch_add(&arrays->buckets[bucket].version, 1, __ATOMIC_RELEASE);
+}
+
+// always in bucket order, so two writers can't deadlock on each other's pair
+static bool _ht_conc_lock_pair(HashTable* ht, _HashTableArrays* arrays, uint64_t a, uint64_t b) {
+    uint64_t low = a < b ? a : b, high = a < b ? b : a;
+    if (!_ht_conc_lock(ht, arrays, low)) {
+        return false;
+    }
+    if (!_ht_conc_lock(ht, arrays, high)) {
+        _ht_conc_unlock(arrays, low);
+        return false;
+    }
+
+    return true;
+}
+
+static void _ht_conc_unlock_pair(_HashTableArrays* arrays, uint64_t a, uint64_t b) {
+    _ht_conc_unlock(arrays, a);
+    _ht_conc_unlock(arrays, b);
+}
+
+static void _ht_conc_store(_HashTableArrays* arrays, uint64_t slot, char* key, void* value, uint8_t tag) {
+    HashTableEntry* entry = _ht_cuckoo_entry(arrays->buckets, slot);
+    __atomic_store_n(&entry->value, value, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->key, key, __ATOMIC_RELEASE);
+    __atomic_store_n(_ht_cuckoo_tag(arrays->buckets, slot), tag, __ATOMIC_RELAXED);
+}
+
+// slot of key in its two buckets; the caller holds both, or validates versions afterwards
+static bool _ht_conc_find(_HashTableArrays* arrays, const uint64_t buckets[2], uint8_t tag, const char* key, uint64_t* slot) {
+    for (int b = 0; b < 2; b++) {
+        HashTableBucket* bucket = &arrays->buckets[buckets[b]];
+        for (int i = 0; i < HT_CUCKOO_WAYS; i++) {
+            if (__atomic_load_n(&bucket->tags[i], __ATOMIC_RELAXED) != tag) continue;
+
+            // a retired key outlives the calling operation, so even a stale pointer is safe to compare
+            const char* candidate = __atomic_load_n(&bucket->entries[i].key, __ATOMIC_ACQUIRE);
+            if (candidate != NULL && strcmp(candidate, key) == 0) {
+                *slot = buckets[b] * HT_CUCKOO_WAYS + i;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void* _ht_conc_get(HashTable* ht, const char* key) {
+    uint64_t* active = _ht_conc_enter(ht);
+    for (;;) {
+        _HashTableArrays* arrays = __atomic_load_n(&ht->_arrays, __ATOMIC_ACQUIRE);
+        uint64_t buckets[2], slot;
+        uint8_t tag;
+        _ht_cuckoo_home(ht, arrays->capacity, key, &buckets[0], &buckets[1], &tag);
+
+        uint32_t first = __atomic_load_n(&arrays->buckets[buckets[0]].version, __ATOMIC_ACQUIRE);
+        uint32_t second = __atomic_load_n(&arrays->buckets[buckets[1]].version, __ATOMIC_ACQUIRE);
+        if ((first | second) & 1) {
+            _ht_conc_pause();
+            continue;
+        }
+
+        void* value = NULL;
+        if (_ht_conc_find(arrays, buckets, tag, key, &slot)) {
+            value = __atomic_load_n(&_ht_cuckoo_entry(arrays->buckets, slot)->value, __ATOMIC_RELAXED);
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&arrays->buckets[buckets[0]].version, __ATOMIC_RELAXED) == first &&
+            __atomic_load_n(&arrays->buckets[buckets[1]].version, __ATOMIC_RELAXED) == second) {
+            _ht_conc_exit(active);
+            return value;
+        }
+    }
+}
+
+// frees a slot in first or second by shifting residents along a cuckoo path, one locked bucket pair per step;
+// false if no path exists. Runs under ht->_lock, so the arrays can't be replaced meanwhile
+static bool _ht_conc_displace(HashTable* ht, _HashTableArrays* arrays, uint64_t first, uint64_t second) {
+    struct {
+        uint64_t bucket;
+        int parent;
+        int parent_slot;
+    } queue[HT_CUCKOO_SEARCH];
+
+    queue[0].bucket = first;
+    queue[1].bucket = second;
+    queue[0].parent = queue[1].parent = -1;
+    queue[0].parent_slot = queue[1].parent_slot = 0;
+    int count = 2;
+
+    for (int head = 0; head < count; head++) {
+        for (int i = 0; i < HT_CUCKOO_WAYS; i++) {
+            uint64_t from = queue[head].bucket * HT_CUCKOO_WAYS + i;
+            const char* resident = __atomic_load_n(&_ht_cuckoo_entry(arrays->buckets, from)->key, __ATOMIC_ACQUIRE);
+            if (resident == NULL) {
+                return true;    // freed by a concurrent remove - just retry the insert
+            }
+
+            uint64_t alt_first, alt_second;
+            uint8_t alt_tag;
+            _ht_cuckoo_home(ht, arrays->capacity, resident, &alt_first, &alt_second, &alt_tag);
+            uint64_t alt = alt_first == queue[head].bucket ? alt_second : alt_first;
+
+            uint64_t base = alt * HT_CUCKOO_WAYS;
+            for (uint64_t free_slot = base; free_slot < base + HT_CUCKOO_WAYS; free_slot++) {
+                if (__atomic_load_n(_ht_cuckoo_tag(arrays->buckets, free_slot), __ATOMIC_RELAXED) != 0) continue;
+
+                // walk back towards first/second, moving each entry into the hole ahead of it; a step whose
+                // entry or hole changed under us ends the walk early, the insert then simply tries again
+                int node = head;
+                uint64_t src = from, dst = free_slot;
+                for (;;) {
+                    uint64_t src_bucket = src / HT_CUCKOO_WAYS, dst_bucket = dst / HT_CUCKOO_WAYS;
+                    _ht_conc_lock_pair(ht, arrays, src_bucket, dst_bucket);
+
+                    HashTableEntry* moving = _ht_cuckoo_entry(arrays->buckets, src);
+                    bool valid = *_ht_cuckoo_tag(arrays->buckets, dst) == 0 && moving->key != NULL;
+                    if (valid) {
+                        uint64_t check_first, check_second;
+                        uint8_t check_tag;
+                        _ht_cuckoo_home(ht, arrays->capacity, moving->key, &check_first, &check_second, &check_tag);
+                        valid = check_first == dst_bucket || check_second == dst_bucket;
+                    }
+                    if (valid) {
+                        _ht_conc_store(arrays, dst, moving->key, moving->value, *_ht_cuckoo_tag(arrays->buckets, src));
+                        _ht_conc_store(arrays, src, NULL, NULL, 0);
+                    }
+                    _ht_conc_unlock_pair(arrays, src_bucket, dst_bucket);
+
+                    if (!valid || queue[node].parent < 0) {
+                        return true;
+                    }
+
+                    dst = src;
+                    src = queue[queue[node].parent].bucket * HT_CUCKOO_WAYS + queue[node].parent_slot;
+                    node = queue[node].parent;
+                }
+            }
+
+            bool on_path = false;
+            for (int node = head; node >= 0 && !on_path; node = queue[node].parent) {
+                on_path = queue[node].bucket == alt;
+            }
+            if (!on_path && count < HT_CUCKOO_SEARCH) {
+                queue[count].bucket = alt;
+                queue[count].parent = head;
+                queue[count].parent_slot = i;
+                count++;
+            }
+        }
+    }
+
+    return false;
+}
+
+// rebuilds into arrays twice the size while holding every bucket of the old ones, which then stay locked so
+// that anyone still using them moves on; runs under ht->_lock. Not incremental: every reader and writer of the
+// table spins until the rehash is done
+static bool _ht_conc_grow(HashTable* ht, _HashTableArrays* arrays) {
+    _HashTableRetired* node = (_HashTableRetired*) malloc (sizeof(_HashTableRetired));
+    _HashTableArrays* grown = (_HashTableArrays*) malloc (sizeof(_HashTableArrays));
+    // checked before taking the buckets, so readers aren't stalled by a grow that can't be allowed anyway
+    uint64_t length = __atomic_load_n(&ht->length, __ATOMIC_RELAXED);
+    if (node == NULL || grown == NULL || !_ht_growth_allowed(length, arrays->capacity * 2)) {
+        free(node);
+        free(grown);
+        return false;
+    }
+
+    uint64_t buckets = arrays->capacity / HT_CUCKOO_WAYS;
+    for (uint64_t b = 0; b < buckets; b++) {
+        _ht_conc_lock(ht, arrays, b);
+    }
+
+    // the single-threaded cuckoo code does the placing on a private table
+    HashTable scratch;
+    memset(&scratch, 0, sizeof(scratch));
+    scratch.hashFunc = ht->hashFunc;
+    scratch.length = length;    // bounds any further doubling by HT_GROWTH_LIMIT
+    scratch.mode = HT_CUCKOO;
+    scratch.capacity = arrays->capacity * 2;
+    scratch.buckets = _ht_cuckoo_alloc(buckets * 2);
+    bool ok = scratch.buckets != NULL;
+    for (uint64_t i = 0; ok && i < arrays->capacity; i++) {
+        if (*_ht_cuckoo_tag(arrays->buckets, i) == 0) continue;
+
+        HashTableEntry* entry = _ht_cuckoo_entry(arrays->buckets, i);
+        while (ok && !_ht_cuckoo_place(&scratch, entry->key, entry->value)) {
+            ok = _ht_cuckoo_grow(&scratch);
+        }
+    }
+
+    if (!ok) {
+        // NULL if the first allocation failed, the last good buckets if a later grow did
+        free(scratch.buckets);
+        for (uint64_t b = 0; b < buckets; b++) {
+            _ht_conc_unlock(arrays, b);
+        }
+        free(node);
+        free(grown);
+        return false;
+    }
+
+    // freshly allocated buckets start with every version at 0, unlocked
+    grown->buckets = scratch.buckets;
+    grown->capacity = scratch.capacity;
+    __atomic_store_n(&ht->_arrays, grown, __ATOMIC_RELEASE);
+
+    ht->buckets = grown->buckets;
+    ht->capacity = grown->capacity;
+    _ht_conc_retire(ht, node, arrays, _ht_conc_free_arrays);
+
+    // outgrown arrays are worth collecting right away
+    __atomic_fetch_add(&ht->_pending, HT_CONCURRENT_COLLECT, __ATOMIC_RELAXED);
+    return true;
+}
+
+static void _ht_conc_spin_lock(uint32_t* lock) {
+    uint32_t expected = 0;
+    while (!__atomic_compare_exchange_n(lock, &expected, 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        expected = 0;
+        _ht_conc_pause();
+    }
+}
+
+static bool _ht_conc_spin_trylock(uint32_t* lock) {
+    uint32_t expected = 0;
+    return __atomic_compare_exchange_n(lock, &expected, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void _ht_conc_spin_unlock(uint32_t* lock) {
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+// frees what the last epoch flip set aside once no operation of the epoch before that flip is left, then sets
+// aside everything retired since and flips again. Never waits for readers, and skips the round if another
+// thread holds ht->_lock; called by writers outside their own operation
+static void _ht_conc_collect(HashTable* ht) {
+    bool due = __atomic_load_n(&ht->_pending, __ATOMIC_RELAXED) >= HT_CONCURRENT_COLLECT ||
+               __atomic_load_n(&ht->_waiting, __ATOMIC_RELAXED) != NULL;
+    if (!due || !_ht_conc_spin_trylock(&ht->_lock)) {
+        return;
+    }
+
+    // a flip only happens once the parity it reuses has drained, so this one covers every older operation
+    uint64_t epoch = __atomic_load_n(&ht->_epoch, __ATOMIC_SEQ_CST);
+    uint64_t draining = 0;
+    for (int i = 0; i < HT_CONCURRENT_STRIPES; i++) {
+        draining += __atomic_load_n(&ht->_stripes[i].active[(epoch - 1) & 1], __ATOMIC_SEQ_CST);
+    }
+
+    _HashTableRetired* ready = NULL;
+    if (draining == 0) {
+        ready = ht->_waiting;
+        _HashTableRetired* waiting = __atomic_exchange_n(&ht->_retired, NULL, __ATOMIC_ACQUIRE);
+        __atomic_store_n(&ht->_waiting, waiting, __ATOMIC_RELAXED);
+        __atomic_store_n(&ht->_pending, 0, __ATOMIC_RELAXED);
+        if (waiting != NULL) {
+            __atomic_store_n(&ht->_epoch, epoch + 1, __ATOMIC_SEQ_CST);
+        }
+    }
+    _ht_conc_spin_unlock(&ht->_lock);
+
+    // destroyFunc runs outside the lock
+    _ht_free_retired(ready);
+}
+
+static const char* _ht_conc_insert(HashTable* ht, const char* key, void* value) {
+    char* copy = strdup(key);
+    _HashTableRetired* node = (_HashTableRetired*) malloc (sizeof(_HashTableRetired));
+    if (copy == NULL || node == NULL) {
+        free(copy);
+        free(node);
+        return NULL;
+    }
+
+    for (;;) {
+        _HashTableArrays* arrays = __atomic_load_n(&ht->_arrays, __ATOMIC_ACQUIRE);
+        uint64_t buckets[2], slot;
+        uint8_t tag;
+        _ht_cuckoo_home(ht, arrays->capacity, key, &buckets[0], &buckets[1], &tag);
+
+        if (!_ht_conc_lock_pair(ht, arrays, buckets[0], buckets[1])) {
+            continue;
+        }
+
+        if (_ht_conc_find(arrays, buckets, tag, key, &slot)) {
+            HashTableEntry* entry = _ht_cuckoo_entry(arrays->buckets, slot);
+            void* old = entry->value;
+            __atomic_store_n(&entry->value, value, __ATOMIC_RELAXED);
+            _ht_conc_unlock_pair(arrays, buckets[0], buckets[1]);
+
+            free(copy);
+            if (ht->destroyFunc != NULL) {
+                _ht_conc_retire(ht, node, old, ht->destroyFunc);
+            } else {
+                free(node);
+            }
+            return key;
+        }
+
+        for (int b = 0; b < 2; b++) {
+            uint64_t base = buckets[b] * HT_CUCKOO_WAYS;
+            for (uint64_t i = base; i < base + HT_CUCKOO_WAYS; i++) {
+                if (*_ht_cuckoo_tag(arrays->buckets, i) == 0) {
+                    _ht_conc_store(arrays, i, copy, value, tag);
+                    _ht_conc_unlock_pair(arrays, buckets[0], buckets[1]);
+
+                    __atomic_fetch_add(&ht->length, 1, __ATOMIC_RELAXED);
+                    free(node);
+                    return key;
+                }
+            }
+        }
+
+        _ht_conc_unlock_pair(arrays, buckets[0], buckets[1]);
+
+        // both buckets full: make room, then go around again
+        bool ok = true;
+        _ht_conc_spin_lock(&ht->_lock);
+        if (__atomic_load_n(&ht->_arrays, __ATOMIC_RELAXED) == arrays && !_ht_conc_displace(ht, arrays, buckets[0], buckets[1])) {
+            ok = _ht_conc_grow(ht, arrays);
+        }
+        _ht_conc_spin_unlock(&ht->_lock);
+
+        if (!ok) {
+            free(copy);
+            free(node);
+            return NULL;
+        }
+    }
+}
+
+static void* _ht_conc_erase(HashTable* ht, const char* key) {
+    _HashTableRetired* node = (_HashTableRetired*) malloc (sizeof(_HashTableRetired));
+    if (node == NULL) {
+        return NULL;
+    }
+
+    for (;;) {
+        _HashTableArrays* arrays = __atomic_load_n(&ht->_arrays, __ATOMIC_ACQUIRE);
+        uint64_t buckets[2], slot;
+        uint8_t tag;
+        _ht_cuckoo_home(ht, arrays->capacity, key, &buckets[0], &buckets[1], &tag);
+
+        if (!_ht_conc_lock_pair(ht, arrays, buckets[0], buckets[1])) {
+            continue;
+        }
+
+        if (!_ht_conc_find(arrays, buckets, tag, key, &slot)) {
+            _ht_conc_unlock_pair(arrays, buckets[0], buckets[1]);
+            free(node);
+            return NULL;
+        }
+
+        HashTableEntry* entry = _ht_cuckoo_entry(arrays->buckets, slot);
+        char* removed = entry->key;
+        void* value = entry->value;
+        _ht_conc_store(arrays, slot, NULL, NULL, 0);
+        _ht_conc_unlock_pair(arrays, buckets[0], buckets[1]);
+
+        __atomic_fetch_sub(&ht->length, 1, __ATOMIC_RELAXED);
+        _ht_conc_retire(ht, node, removed, free);
+        return value;
+    }
+}
+
+static const char* _ht_conc_set(HashTable* ht, const char* key, void* value) {
+    uint64_t* active = _ht_conc_enter(ht);
+    const char* result = _ht_conc_insert(ht, key, value);
+    _ht_conc_exit(active);
+
+    _ht_conc_collect(ht);
+    return result;
+}
+
+static void* _ht_conc_remove(HashTable* ht, const char* key) {
+    uint64_t* active = _ht_conc_enter(ht);
+    void* value = _ht_conc_erase(ht, key);
+    _ht_conc_exit(active);
+
+    _ht_conc_collect(ht);
+    return value;
+}
+
+// HT_CONCURRENT: until the matching ht_unpin, nothing retired from now on is freed - values from ht_get stay
+// valid even if another thread replaces or removes them. Pins nest; a thread that never unpins stops reclamation
+HashTablePin ht_pin(HashTable* ht) {
+    HashTablePin pin;
+    pin._active = _ht_conc_enter(ht);
+    return pin;
+}
+
+void ht_unpin(HashTablePin pin) {
+    _ht_conc_exit(pin._active);
+}
+
+// HT_CONCURRENT: destroys ptr once no operation or pin from before this call is left, typically a value taken
+// out with ht_remove. False if out of memory, in which case ptr is left alone
+bool ht_retire(HashTable* ht, void* ptr, DestroyFunc destroy) {
+    _HashTableRetired* node = (_HashTableRetired*) malloc (sizeof(_HashTableRetired));
+    if (node == NULL) {
+        return false;
+    }
+
+    _ht_conc_retire(ht, node, ptr, destroy);
+    _ht_conc_collect(ht);
+    return true;
+}
+
+#endif
+
+void* ht_get(HashTable* ht, const char* key) {
+    if (ht->mode == HT_COMPACT) {
+        uint64_t slot;
+        return _ht_compact_find(ht, key, _ht_compact_hash(ht, key), &slot)
+            ? *(void**) _ht_compact_record(ht, ht->slots[slot].offset) : NULL;
+    }
+#ifdef HT_CONCURRENT_SUPPORTED
+    if (ht->mode == HT_CONCURRENT) {
+        return _ht_conc_get(ht, key);
+    }
+#endif
+    if (ht->mode == HT_HOPSCOTCH) {
+        uint64_t slot;
+        return _ht_hop_find(ht, key, &slot) ? ht->entries[slot].value : NULL;
+    }
+    if (ht->mode == HT_CUCKOO) {
+        uint64_t slot;
+        return _ht_cuckoo_find(ht, key, &slot) ? _ht_cuckoo_entry(ht->buckets, slot)->value : NULL;
+    }
+
+    uint64_t hash = ht->hashFunc(key);
+    uint64_t index = (size_t)(hash & (uint64_t)(ht->capacity - 1));
+
+    while (ht->entries[index].key != NULL) {
+        if (strcmp(ht->entries[index].key, key) == 0) {
+            return ht->entries[index].value;
+        }
+
+        index = (index + 1) % ht->capacity;
+    }
+
+    return NULL;
+}
+
+int ht_expand(HashTable* ht) {
+    uint64_t newCapacity = ht->capacity * 2;
+    HashTableEntry* newEntries = (HashTableEntry*) calloc (newCapacity, sizeof(HashTableEntry));
+    if (newEntries == NULL) {
+        return 0;
+    }
+
+    for (uint64_t i = 0; i < ht->capacity; i++) {
+        if (ht->entries[i].key != NULL) {
+            uint64_t hash = ht->hashFunc(ht->entries[i].key);
+            uint64_t index = (size_t)(hash & (uint64_t)(newCapacity - 1));
+
+            while (newEntries[index].key != NULL) {
+                index = (index + 1) % newCapacity;
+            }
+
+            newEntries[index].key = ht->entries[i].key;
+            newEntries[index].value = ht->entries[i].value;
+        }
+    }
+
+    free(ht->entries);
+    ht->entries = newEntries;
+    ht->capacity = newCapacity;
+
+    return 1;
+}
+
+const char* ht_set(HashTable* ht, const char* key, void* value) {
+    if (value == NULL) {
+        return NULL;
+    }
+
+    if (ht->mode == HT_CUCKOO) {
+        return _ht_cuckoo_set(ht, key, value);
+    }
+    if (ht->mode == HT_HOPSCOTCH) {
+        return _ht_hop_set(ht, key, value);
+    }
+    if (ht->mode == HT_COMPACT) {
+        return _ht_compact_set(ht, key, value);
+    }
+#ifdef HT_CONCURRENT_SUPPORTED
+    if (ht->mode == HT_CONCURRENT) {
+        return _ht_conc_set(ht, key, value);
+    }
+#endif
+
+    if (ht->length >= ht->capacity) {
+        if (!ht_expand(ht)) {
+            return NULL;
+        }
+    }
+
+    uint64_t hash = ht->hashFunc(key);
+    uint64_t index = (size_t)(hash & (uint64_t)(ht->capacity - 1));
+
+    while (ht->entries[index].key != NULL) {
+        if (strcmp(ht->entries[index].key, key) == 0) {
+            if (ht->destroyFunc != NULL) {
+                ht->destroyFunc(ht->entries[index].value);
+            }
+            ht->entries[index].value = value;
+            return key;
+        }
+
+        index = (index + 1) % ht->capacity;
+    }
+
+    if (ht->entries[index].key == NULL) {
+        ht->entries[index].key = strdup(key);
+        if (ht->entries[index].key == NULL) return NULL;
+        ht->entries[index].value = value;
+        ht->length++;
+    } else {
+        return NULL;
+    }
+
+    return key;
+}
+
+void* ht_remove(HashTable* ht, const char* key) {
+    if (ht->mode == HT_CUCKOO) {
+        return _ht_cuckoo_remove(ht, key);
+    }
+    if (ht->mode == HT_HOPSCOTCH) {
+        return _ht_hop_remove(ht, key);
+    }
+    if (ht->mode == HT_COMPACT) {
+        return _ht_compact_remove(ht, key);
+    }
+#ifdef HT_CONCURRENT_SUPPORTED
+    if (ht->mode == HT_CONCURRENT) {
+        return _ht_conc_remove(ht, key);
+    }
+#endif
+
+    uint64_t hash = ht->hashFunc(key);
+    uint64_t index = (size_t)(hash & (uint64_t)(ht->capacity - 1));
+
+    while (ht->entries[index].key != NULL) {
+        if (strcmp(ht->entries[index].key, key) == 0) {
+            void* value = ht->entries[index].value;
+            ht->entries[index].key = NULL;
+            ht->entries[index].value = NULL;
+            ht->length--;
+            return value;
+        }
+
+        index = (index + 1) % ht->capacity;
+    }
+
+    return NULL;
+}
+
+HashTableIterator* ht_iterator(HashTable* ht) {
+    HashTableIterator* it = (HashTableIterator*) malloc (sizeof(HashTableIterator));
+    if (it == NULL) {
+        return NULL;
+    }
+
+    it->key = NULL;
+    it->value = NULL;
+    it->_ht = ht;
+    it->_index = 0;
+
+    return it;
+}
+
+bool ht_next(HashTableIterator* it) {
+    if (it->_ht->mode == HT_COMPACT) {
+        for (; it->_index < it->_ht->capacity; it->_index++) {
+            uint32_t offset = it->_ht->slots[it->_index].offset;
+            if (offset != 0) {
+                char* record = _ht_compact_record(it->_ht, offset);
+                it->key = record + sizeof(void*);
+                it->value = *(void**) record;
+                it->_index++;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    if (it->_ht->buckets != NULL) {
+        for (; it->_index < it->_ht->capacity; it->_index++) {
+            HashTableEntry* entry = _ht_cuckoo_entry(it->_ht->buckets, it->_index);
+            if (entry->key != NULL) {
+                it->key = entry->key;
+                it->value = entry->value;
+                it->_index++;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    while (it->_index < it->_ht->capacity) {
+        if (it->_ht->entries[it->_index].key != NULL) {
+            it->key = it->_ht->entries[it->_index].key;
+            it->value = it->_ht->entries[it->_index].value;
+            it->_index++;
+            return true;
+        }
+
+        it->_index++;
+    }
+
+    return false;
+}
+
+#ifdef HT_CONCURRENT_SUPPORTED
+
+HashTableRcu* ht_rcu_create(HashTable* initial) {
+    HashTableRcu* rcu = (HashTableRcu*) malloc (sizeof(HashTableRcu));
+    if (rcu == NULL) {
+        return NULL;
+    }
+
+    rcu->_current = initial;
+    rcu->_epoch = 0;
+    rcu->_readers = NULL;
+    rcu->_retired = NULL;
+    rcu->_lock = 0;
+
+    return rcu;
+}
+
+// only once every reader thread is done with it
+void ht_rcu_destroy(HashTableRcu* rcu) {
+    while (rcu->_retired != NULL) {
+        _HashTableRcuRetired* next = rcu->_retired->next;
+        ht_destroy(rcu->_retired->table);
+        free(rcu->_retired);
+        rcu->_retired = next;
+    }
+
+    while (rcu->_readers != NULL) {
+        HashTableRcuReader* next = rcu->_readers->_next;
+        free(rcu->_readers);
+        rcu->_readers = next;
+    }
+
+    if (rcu->_current != NULL) {
+        ht_destroy(rcu->_current);
+    }
+    free(rcu);
+}
+
+HashTable* ht_rcu_current(HashTableRcu* rcu) {
+    return __atomic_load_n(&rcu->_current, __ATOMIC_SEQ_CST);
+}
+
+HashTableRcuReader* ht_rcu_register(HashTableRcu* rcu) {
+    // reuse the slot of a thread that unregistered, if any
+    HashTableRcuReader* reader = __atomic_load_n(&rcu->_readers, __ATOMIC_ACQUIRE);
+    for (; reader != NULL; reader = reader->_next) {
+        uint32_t idle = 0;
+        if (__atomic_compare_exchange_n(&reader->_active, &idle, 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    if (reader == NULL) {
+        size_t bytes = (sizeof(HashTableRcuReader) + 63) / 64 * 64;
+        reader = (HashTableRcuReader*) aligned_alloc (64, bytes);
+        if (reader == NULL) {
+            return NULL;
+        }
+
+        reader->_rcu = rcu;
+        reader->_active = 1;
+        reader->_epoch = __atomic_load_n(&rcu->_epoch, __ATOMIC_SEQ_CST);
+        reader->_next = __atomic_load_n(&rcu->_readers, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&rcu->_readers, &reader->_next, reader, true, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+        return reader;
+    }
+
+    ht_rcu_quiescent(reader);
+    return reader;
+}
+
+void ht_rcu_unregister(HashTableRcuReader* reader) {
+    __atomic_store_n(&reader->_active, 0, __ATOMIC_SEQ_CST);
+}
+
+// the calling thread holds no table or value obtained through ht_rcu_current before this call
+void ht_rcu_quiescent(HashTableRcuReader* reader) {
+    __atomic_store_n(&reader->_epoch, __atomic_load_n(&reader->_rcu->_epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+}
+
+static size_t _ht_rcu_collect_locked(HashTableRcu* rcu) {
+    uint64_t safe = __atomic_load_n(&rcu->_epoch, __ATOMIC_SEQ_CST);
+    for (HashTableRcuReader* reader = __atomic_load_n(&rcu->_readers, __ATOMIC_ACQUIRE); reader != NULL; reader = reader->_next) {
+        if (__atomic_load_n(&reader->_active, __ATOMIC_SEQ_CST)) {
+            uint64_t epoch = __atomic_load_n(&reader->_epoch, __ATOMIC_SEQ_CST);
+            if (epoch < safe) safe = epoch;
+        }
+    }
+
+    size_t freed = 0;
+    _HashTableRcuRetired** link = &rcu->_retired;
+    while (*link != NULL) {
+        _HashTableRcuRetired* retired = *link;
+        if (retired->epoch <= safe) {
+            *link = retired->next;
+            ht_destroy(retired->table);
+            free(retired);
+            freed++;
+        } else {
+            link = &retired->next;
+        }
+    }
+
+    return freed;
+}
+
+// makes fresh the table readers see and takes ownership of it; the replaced one is destroyed by a later collect.
+// False (nothing published) if out of memory
+bool ht_rcu_publish(HashTableRcu* rcu, HashTable* fresh) {
+    _HashTableRcuRetired* retired = (_HashTableRcuRetired*) malloc (sizeof(_HashTableRcuRetired));
+    if (retired == NULL) {
+        return false;
+    }
+
+    _ht_conc_spin_lock(&rcu->_lock);
+    retired->table = __atomic_exchange_n(&rcu->_current, fresh, __ATOMIC_SEQ_CST);
+    retired->epoch = __atomic_add_fetch(&rcu->_epoch, 1, __ATOMIC_SEQ_CST);
+
+    if (retired->table != NULL) {
+        retired->next = rcu->_retired;
+        rcu->_retired = retired;
+    } else {
+        free(retired);
+    }
+
+    _ht_rcu_collect_locked(rcu);
+    _ht_conc_spin_unlock(&rcu->_lock);
+    return true;
+}
+
+// destroys the replaced tables no reader can still hold; returns how many
+size_t ht_rcu_collect(HashTableRcu* rcu) {
+    _ht_conc_spin_lock(&rcu->_lock);
+    size_t freed = _ht_rcu_collect_locked(rcu);
+    _ht_conc_spin_unlock(&rcu->_lock);
+    return freed;
+}
+
+// waits until every registered reader has passed a quiescent point, then collects everything replaced so far;
+// must not be called from a registered reader thread
+void ht_rcu_synchronize(HashTableRcu* rcu) {
+    uint64_t target = __atomic_load_n(&rcu->_epoch, __ATOMIC_SEQ_CST);
+    for (HashTableRcuReader* reader = __atomic_load_n(&rcu->_readers, __ATOMIC_ACQUIRE); reader != NULL; reader = reader->_next) {
+        while (__atomic_load_n(&reader->_active, __ATOMIC_SEQ_CST) &&
+               __atomic_load_n(&reader->_epoch, __ATOMIC_SEQ_CST) < target) {
+            _ht_conc_pause();
+        }
+    }
+
+    ht_rcu_collect(rcu);
+}
+
+#endif
+
 #endif
 #endif